@@ -0,0 +1,99 @@
+#pragma once
+
+#include "broadphase2d.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+// windows.h must come first
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Minimal helpers shared by the benchmark executables, no external deps.
+// Parameters are passed like build.sh ones: bench_xxx pairs=4096 seed=1
+
+class benchArgs {
+    std::map<std::string, std::string> values;
+
+  public:
+    benchArgs(int argc, char **argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto eq = arg.find('=');
+            if (eq != std::string::npos)
+                values[arg.substr(0, eq)] = arg.substr(eq + 1);
+        }
+    }
+
+    double get(const std::string &name, double defaultValue) const {
+        auto it = values.find(name);
+        return it == values.end() ? defaultValue
+                                  : std::atof(it->second.c_str());
+    }
+    std::string get(const std::string &name,
+                    const std::string &defaultValue) const {
+        auto it = values.find(name);
+        return it == values.end() ? defaultValue : it->second;
+    }
+};
+
+class benchTimer {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+  public:
+    void restart() { start = std::chrono::steady_clock::now(); }
+    double elapsed() const { // sec
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start)
+            .count();
+    }
+};
+
+// Repeat fn() until minTime passed, returns average sec per call
+template <typename F> double benchRepeat(F &&fn, double minTime = 0.2) {
+    fn(); // warm up
+    std::size_t iterations = 0;
+    benchTimer timer;
+    do {
+        fn();
+        iterations++;
+    } while (timer.elapsed() < minTime);
+    return timer.elapsed() / iterations;
+}
+
+// Peak resident set size of the whole process, bytes
+inline std::size_t peakRSS() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return std::size_t(usage.ru_maxrss) * 1024; // KiB on linux
+    return 0;
+#endif
+}
+
+// names accepted by the broadphase= parameter
+inline const std::vector<std::pair<std::string, BroadphaseType>> &
+broadphaseTypes() {
+    static const std::vector<std::pair<std::string, BroadphaseType>> types{
+        {"kdtree", BroadphaseType::KDTree},
+        {"aabbtree", BroadphaseType::AABBTree},
+        {"bvh", BroadphaseType::BVH},
+        {"sap", BroadphaseType::SweepAndPrune},
+        {"hash", BroadphaseType::SpatialHash},
+        {"twolevel", BroadphaseType::TwoLevel}};
+    return types;
+}
@@ -0,0 +1,311 @@
+#include "bench.h"
+#include "kdtree2d.h"
+#include "object2d.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// KDTree2d build, parseTree and intersect on synthetic primitive sets, then
+// every broadphase2d over a few frames of small and of large random motion.
+//   count=10000     primitives per scenario
+//   queries=1000    intersect queries
+//   frames=20       motion frames per broadphase
+//   jump=5          largest step of the large motion, the small one is 0.1
+//   scenario=all    uniform, clustered, mixed, grid
+//   threads=0       of the parallel build and parseTree, 0 takes every
+//                   hardware thread
+//   seed=1
+
+namespace {
+
+std::mt19937 gen;
+
+real randomIn(real min, real max) {
+    return std::uniform_real_distribution<real>(min, max)(gen);
+}
+
+struct scene {
+    std::vector<std::unique_ptr<object2d>> objects;
+    std::size_t primitives = 0;
+};
+
+void addCircleObject(scene &s, const vec2d &pos, double radius) {
+    s.objects.push_back(std::make_unique<object2d>());
+    object2d *object = s.objects.back().get();
+    object->add(new circle2d({0, 0}, radius));
+    object->setPos(pos);
+    object->setAngle(0);
+    s.primitives++;
+}
+
+// one circle per object, spread evenly, ~3 units per primitive on each axis
+scene makeUniform(std::size_t count) {
+    scene s;
+    real side = std::sqrt(double(count)) * 3;
+    for (std::size_t i = 0; i < count; i++)
+        addCircleObject(s,
+                        {randomIn(-side / 2, side / 2),
+                         randomIn(-side / 2, side / 2)},
+                        randomIn(0.3, 1));
+    return s;
+}
+
+scene makeClustered(std::size_t count) {
+    scene s;
+    real side = std::sqrt(double(count)) * 3;
+    std::vector<vec2d> centers;
+    for (int i = 0; i < 16; i++)
+        centers.push_back(
+            {randomIn(-side / 2, side / 2), randomIn(-side / 2, side / 2)});
+
+    std::normal_distribution<> spread(0, side / 40);
+    for (std::size_t i = 0; i < count; i++) {
+        vec2d center = centers[i % centers.size()];
+        addCircleObject(s, center + vec2d(spread(gen), spread(gen)),
+                        randomIn(0.3, 1));
+    }
+    return s;
+}
+
+// mostly tiny boxes with a few huge ones straddling many cells
+scene makeMixed(std::size_t count) {
+    scene s;
+    real side = std::sqrt(double(count)) * 3;
+    for (std::size_t i = 0; i < count; i++)
+        addCircleObject(
+            s,
+            {randomIn(-side / 2, side / 2), randomIn(-side / 2, side / 2)},
+            i % 20 == 0 ? randomIn(10, 30) : randomIn(0.05, 0.2));
+    return s;
+}
+
+// circle grid bricks like in GLWidget::initializeGL, 400 primitives each
+scene makeGrid(std::size_t count) {
+    scene s;
+    constexpr int grid = 20;
+    std::size_t objectsNumber =
+        std::max<std::size_t>(1, count / (grid * grid));
+    real side = std::sqrt(double(objectsNumber)) * 30;
+    for (std::size_t n = 0; n < objectsNumber; n++) {
+        s.objects.push_back(std::make_unique<object2d>());
+        object2d *object = s.objects.back().get();
+
+        real width = 5 + randomIn(0, 20);
+        real height = 5 + randomIn(0, 20);
+        for (int i = 0; i < grid; i++)
+            for (int j = 0; j < grid; j++)
+                object->add(new circle2d(
+                    {-width / 2 + i * (width / grid),
+                     -height / 2 + j * (height / grid)},
+                    std::min(width / grid, height / grid) / 2));
+        s.primitives += grid * grid;
+        object->setPos(
+            {randomIn(-side / 2, side / 2), randomIn(-side / 2, side / 2)});
+        object->setAngle(randomIn(0, 2 * pi));
+    }
+    return s;
+}
+
+bBox precalc(std::vector<std::unique_ptr<object2d>> &objects) {
+    bBox bbox;
+    bool bboxInit = false;
+    for (auto &object : objects) {
+        object->precalcCollisionModel();
+        if (bboxInit)
+            bbox += object->getBBox();
+        else {
+            bbox = object->getBBox();
+            bboxInit = true;
+        }
+    }
+    return bbox;
+}
+
+// every object moves up to motion and turns each frame, by the same sequence
+// for every broadphase, from the same layout
+void benchBroadphases(std::vector<std::unique_ptr<object2d>> &objects,
+                      std::size_t frames, real motion) {
+    std::list<object2d *> list;
+    std::vector<std::pair<vec2d, real>> layout;
+    for (auto &object : objects) {
+        list.push_back(object.get());
+        layout.push_back({object->getPos(), object->getAngle()});
+    }
+
+    std::printf("  motion %g per frame\n", motion);
+    std::printf("  %-10s %10s %12s %12s %10s %12s\n", "broadphase",
+                "first ms", "update ms", "pairs ms", "pairs", "memory KiB");
+    for (const auto &[name, type] : broadphaseTypes()) {
+        for (std::size_t i = 0; i < objects.size(); i++) {
+            objects[i]->setPos(layout[i].first);
+            objects[i]->setAngle(layout[i].second);
+            objects[i]->precalcCollisionModel();
+        }
+
+        std::unique_ptr<broadphase2d> broadphase(broadphase2d::create(type));
+        std::mt19937 sequence(1);
+        std::uniform_real_distribution<> step(-motion, motion);
+
+        benchTimer timer;
+        broadphase->update(list);
+        double firstSec = timer.elapsed();
+
+        double updateSec = 0, pairsSec = 0;
+        std::size_t pairsNumber = 0;
+        std::vector<std::pair<Item, Item>> pairs;
+        for (std::size_t frame = 0; frame < frames; frame++) {
+            for (auto object : list) {
+                object->setPos(object->getPos() +
+                               vec2d(step(sequence), step(sequence)));
+                object->setAngle(object->getAngle() +
+                                 step(sequence) / motion * 0.01);
+                object->precalcCollisionModel();
+            }
+
+            timer.restart();
+            broadphase->update(list);
+            updateSec += timer.elapsed();
+
+            timer.restart();
+            pairs.clear();
+            broadphase->findPairs(pairs);
+            pairsSec += timer.elapsed();
+            pairsNumber += pairs.size();
+        }
+
+        std::printf("  %-10s %10.3f %12.3f %12.3f %10zu %12.1f\n",
+                    name.c_str(), firstSec * 1e3, updateSec / frames * 1e3,
+                    pairsSec / frames * 1e3, pairsNumber / frames,
+                    broadphase->memoryUsage() / 1024.0);
+    }
+}
+
+void benchScenario(const std::string &name, scene s, std::size_t queries,
+                   std::size_t frames, real jump, threadPool2d &pool) {
+    auto &objects = s.objects;
+    std::size_t primitives = s.primitives;
+    bBox bbox = precalc(objects);
+
+    double buildSec = benchRepeat([&]() {
+        KDTree2d tree(bbox);
+        for (auto &object : objects)
+            object->precalcCollisionModel_KDTree(&tree);
+    });
+
+    KDTree2d tree(bbox);
+    for (auto &object : objects)
+        object->precalcCollisionModel_KDTree(&tree);
+
+    // the same tree in one pass, big subtrees on the threads of pool
+    std::vector<Item> items;
+    for (auto &object : objects) {
+        const auto &model = object->getCollisionModel_precalc();
+        const auto &bboxes = object->getCollisionModel_bBoxes();
+        for (std::size_t i = 0; i < model.size(); i++)
+            items.push_back({bboxes[i], object.get(), model[i]});
+    }
+    std::vector<std::deque<KDTree2d>> arenas;
+    double parallelBuildSec = benchRepeat([&]() {
+        KDTree2d tree(bbox);
+        tree.build(items, &pool, arenas);
+    });
+
+    std::vector<std::pair<Item, Item>> pairs;
+    double parseSec = benchRepeat([&]() {
+        pairs.clear();
+        tree.parseTree(pairs);
+    });
+    std::vector<std::vector<std::pair<Item, Item>>> buffers;
+    double parallelParseSec = benchRepeat([&]() {
+        pairs.clear();
+        tree.parseTree(pairs, &pool, buffers);
+    });
+
+    std::size_t pairsTotal = pairs.size();
+    std::sort(begin(pairs), end(pairs),
+              [](const std::pair<Item, Item> &i,
+                 const std::pair<Item, Item> &j) {
+                  return std::make_pair(i.first.primitive,
+                                        i.second.primitive) <
+                         std::make_pair(j.first.primitive, j.second.primitive);
+              });
+    auto uniqueEnd = std::unique(begin(pairs), end(pairs),
+                                 [](const std::pair<Item, Item> &i,
+                                    const std::pair<Item, Item> &j) {
+                                     return i.first.primitive ==
+                                                j.first.primitive &&
+                                            i.second.primitive ==
+                                                j.second.primitive;
+                                 });
+    std::size_t pairsUnique = uniqueEnd - begin(pairs);
+
+    // query boxes of a typical primitive size, like world2d::intersect
+    std::vector<bBox> boxes;
+    for (std::size_t i = 0; i < queries; i++) {
+        double x = randomIn(bbox.getMinX(), bbox.getMaxX());
+        double y = randomIn(bbox.getMinY(), bbox.getMaxY());
+        boxes.push_back(bBox(x - 0.5, y - 0.5, x + 0.5, y + 0.5));
+    }
+    std::vector<Item> result;
+    std::size_t found = 0;
+    double querySec = benchRepeat([&]() {
+        found = 0;
+        for (const auto &box : boxes) {
+            result.clear();
+            tree.intersect(box, result);
+            found += result.size();
+        }
+    });
+
+    std::printf("\n%s: %zu objects, %zu primitives\n", name.c_str(),
+                objects.size(), primitives);
+    std::printf("  build        %10.3f ms\n", buildSec * 1e3);
+    std::printf("  build        %10.3f ms on %zu threads\n",
+                parallelBuildSec * 1e3, pool.getThreads());
+    std::printf("  nodes        %10zu\n", tree.nodeCount());
+    std::printf("  items        %10zu (%.2f per primitive)\n",
+                tree.itemCount(), double(tree.itemCount()) / primitives);
+    std::printf("  memory       %10.1f KiB\n", tree.memoryUsage() / 1024.0);
+    std::printf("  parseTree    %10.3f ms\n", parseSec * 1e3);
+    std::printf("  parseTree    %10.3f ms on %zu threads\n",
+                parallelParseSec * 1e3, pool.getThreads());
+    std::printf("  pairs        %10zu (%zu unique, %.2fx duplicated)\n",
+                pairsTotal, pairsUnique,
+                pairsUnique ? double(pairsTotal) / pairsUnique : 0.0);
+    std::printf("  intersect    %10.3f us/query, %.1f items/query\n",
+                querySec / boxes.size() * 1e6, double(found) / boxes.size());
+
+    benchBroadphases(objects, frames, 0.1);
+    benchBroadphases(objects, frames, jump);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    benchArgs args(argc, argv);
+    std::size_t count = args.get("count", 10000);
+    std::size_t queries = args.get("queries", 1000);
+    std::size_t frames = args.get("frames", 20);
+    real jump = args.get("jump", 5.0);
+    std::string scenario = args.get("scenario", std::string("all"));
+    threadPool2d pool(args.get("threads", 0));
+    gen.seed(args.get("seed", 1));
+
+    if (scenario == "all" || scenario == "uniform")
+        benchScenario("uniform", makeUniform(count), queries, frames, jump,
+                      pool);
+    if (scenario == "all" || scenario == "clustered")
+        benchScenario("clustered", makeClustered(count), queries, frames,
+                      jump, pool);
+    if (scenario == "all" || scenario == "mixed")
+        benchScenario("mixed", makeMixed(count), queries, frames, jump, pool);
+    if (scenario == "all" || scenario == "grid")
+        benchScenario("grid", makeGrid(count), queries, frames, jump, pool);
+
+    return 0;
+}
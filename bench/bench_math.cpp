@@ -0,0 +1,192 @@
+#include "bench.h"
+#include "math2d.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// math2d operations inlined against the same operations through calls the
+// compiler cannot inline, what each of them cost while math2d was compiled
+// out of line, and fused against unfused forms. "same" is whether the
+// variant gives bit identical results to the first one of its group, any
+// "NO" makes the exit status 1 so ctest runs this as a check.
+//   points=4096
+//   seed=1
+
+namespace {
+
+std::mt19937 gen;
+bool mismatch = false;
+
+real randomIn(real min, real max) {
+    return std::uniform_real_distribution<real>(min, max)(gen);
+}
+
+// volatile, every call loads the pointer and stays a call
+vec2d (*volatile callAdd)(const vec2d &, const vec2d &) =
+    [](const vec2d &v1, const vec2d &v2) { return v1 + v2; };
+vec2d (*volatile callSub)(const vec2d &, const vec2d &) =
+    [](const vec2d &v1, const vec2d &v2) { return v1 - v2; };
+vec2d (*volatile callScale)(const vec2d &, real) =
+    [](const vec2d &v, real scale) { return v * scale; };
+vec2d (*volatile callDivide)(const vec2d &, real) =
+    [](const vec2d &v, real divisor) { return v / divisor; };
+vec2d (*volatile callNeg)(const vec2d &) = [](const vec2d &v) { return -v; };
+real (*volatile callLength)(const vec2d &) = [](const vec2d &v) {
+    return v.length();
+};
+real (*volatile callLength2)(const vec2d &) = [](const vec2d &v) {
+    return v.length2();
+};
+vec2d (*volatile callTransform)(const vec2d &, const mat23 &) =
+    [](const vec2d &v, const mat23 &m) { return v * m; };
+
+struct contact {
+    vec2d pos, normal1, normal2;
+    real depth;
+};
+
+// circle/circle contact, the vector math of the narrowphase
+template <bool inlined>
+bool circleContact(const vec2d &pos1, real r1, const vec2d &pos2, real r2,
+                   contact &result) {
+    vec2d dist = inlined ? pos2 - pos1 : callSub(pos2, pos1);
+    real radius = r1 + r2;
+    if ((inlined ? dist.length2() : callLength2(dist)) > radius * radius)
+        return false;
+
+    real length = inlined ? dist.length() : callLength(dist);
+    vec2d normal = inlined ? dist / length : callDivide(dist, length);
+    result.pos = inlined ? pos1 + dist * (r1 / radius)
+                         : callAdd(pos1, callScale(dist, r1 / radius));
+    result.normal1 = normal;
+    result.normal2 = inlined ? -normal : callNeg(normal);
+    result.depth = radius - length;
+    return true;
+}
+
+template <typename T>
+bool sameBits(const std::vector<T> &first, const std::vector<T> &second) {
+    return first.size() == second.size() &&
+           std::memcmp(first.data(), second.data(),
+                       first.size() * sizeof(T)) == 0;
+}
+
+void report(const std::string &name, std::size_t points, double sec,
+            bool same) {
+    mismatch |= !same;
+    std::printf("%-28s %14.0f %10.2f %10s\n", name.c_str(), points / sec,
+                sec / points * 1e9, same ? "yes" : "NO");
+}
+
+void benchTransform(std::size_t count) {
+    std::vector<vec2d> points(count), reference(count), result(count);
+    for (auto &point : points)
+        point = vec2d(randomIn(-100, 100), randomIn(-100, 100));
+    mat23 matrix = mat23::makeRotate(randomIn(0, 2 * pi))
+                       .translated(randomIn(-100, 100), randomIn(-100, 100));
+
+    double sec = benchRepeat([&]() {
+        for (std::size_t i = 0; i < count; i++)
+            reference[i] = callTransform(points[i], matrix);
+    });
+    report("vec2d * mat23 (call)", count, sec, true);
+
+    sec = benchRepeat([&]() {
+        for (std::size_t i = 0; i < count; i++)
+            result[i] = points[i] * matrix;
+    });
+    report("vec2d * mat23 (inline)", count, sec, sameBits(reference, result));
+
+    const char *names[] = {"scalar", "sse2", "avx2"};
+    for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        if (level > simdLevel())
+            break;
+        sec = benchRepeat([&]() {
+            matrix.transform(points.data(), result.data(), count, level);
+        });
+        report(std::string("mat23::transform (") + names[int(level)] + ")",
+               count, sec, sameBits(reference, result));
+    }
+}
+
+// object matrices as object2d::precalcCollisionModel builds them
+void benchMatrix(std::size_t count) {
+    std::vector<real> angles(count), sines(count), cosines(count);
+    std::vector<vec2d> positions(count);
+    for (std::size_t i = 0; i < count; i++) {
+        angles[i] = randomIn(0, 2 * pi);
+        sines[i] = std::sin(angles[i]);
+        cosines[i] = std::cos(angles[i]);
+        positions[i] = vec2d(randomIn(-100, 100), randomIn(-100, 100));
+    }
+    std::vector<mat23> reference(count), result(count);
+
+    double sec = benchRepeat([&]() {
+        for (std::size_t i = 0; i < count; i++) {
+            mat23 matrix;
+            matrix.rotate(angles[i]);
+            matrix.translate(positions[i]);
+            reference[i] = matrix;
+        }
+    });
+    report("rotate, translate", count, sec, true);
+
+    sec = benchRepeat([&]() {
+        for (std::size_t i = 0; i < count; i++)
+            result[i] = mat23::makeRotate(angles[i]).translated(positions[i]);
+    });
+    report("makeRotate().translated()", count, sec,
+           sameBits(reference, result));
+
+    // the sine and cosine come from elsewhere, like one angle shared by
+    // several matrices and vectors
+    sec = benchRepeat([&]() {
+        for (std::size_t i = 0; i < count; i++)
+            result[i] = mat23::makeRotate(sines[i], cosines[i])
+                            .translated(positions[i]);
+    });
+    report("makeRotate(sin, cos)", count, sec, sameBits(reference, result));
+}
+
+void benchContact(std::size_t count) {
+    std::vector<vec2d> pos1(count), pos2(count);
+    std::vector<real> r1(count), r2(count);
+    for (std::size_t i = 0; i < count; i++) {
+        pos1[i] = vec2d(randomIn(-100, 100), randomIn(-100, 100));
+        pos2[i] = pos1[i] + vec2d(randomIn(0, 2 * pi)) * randomIn(0, 3);
+        r1[i] = randomIn(0.2, 1);
+        r2[i] = randomIn(0.2, 1);
+    }
+    std::vector<contact> reference(count), result(count);
+
+    double sec = benchRepeat([&]() {
+        for (std::size_t i = 0; i < count; i++)
+            circleContact<false>(pos1[i], r1[i], pos2[i], r2[i],
+                                 reference[i]);
+    });
+    report("circle contact (call)", count, sec, true);
+
+    sec = benchRepeat([&]() {
+        for (std::size_t i = 0; i < count; i++)
+            circleContact<true>(pos1[i], r1[i], pos2[i], r2[i], result[i]);
+    });
+    report("circle contact (inline)", count, sec, sameBits(reference, result));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    benchArgs args(argc, argv);
+    std::size_t points = args.get("points", 4096);
+    gen.seed(args.get("seed", 1));
+
+    std::printf("%-28s %14s %10s %10s\n", "operation", "points/sec",
+                "ns/point", "same");
+    benchTransform(points);
+    benchMatrix(points);
+    benchContact(points);
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+#include "bench.h"
+#include "circlebatch2d.h"
+#include "math2d.h"
+#include "primitive2d.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Throughput of every collisionPrimitives overload and of the generic
+// primitive2d dispatch table, pair by pair and batched by type pair, and
+// of the SIMD circle/circle kernel.
+//   pairs=4096  dataset size per pair type
+//   ratio=0.5   wanted hit ratio, -1 runs 0.1, 0.5 and 0.9
+//   seed=1
+
+namespace {
+
+std::mt19937 gen;
+
+real randomIn(real min, real max) {
+    return std::uniform_real_distribution<real>(min, max)(gen);
+}
+
+template <typename T> T makePrimitive(const vec2d &pos);
+
+template <> circle2d makePrimitive<circle2d>(const vec2d &pos) {
+    circle2d c(pos, randomIn(0.2, 1));
+    c.precalc(mat23());
+    return c;
+}
+
+template <> line2d makePrimitive<line2d>(const vec2d &pos) {
+    vec2d half = vec2d(randomIn(0, 2 * pi)) * randomIn(0.25, 1.5);
+    line2d l(pos - half, pos + half);
+    l.precalc(mat23());
+    return l;
+}
+
+template <> rectangle2d makePrimitive<rectangle2d>(const vec2d &pos) {
+    rectangle2d r(pos, {randomIn(0.5, 3), randomIn(0.5, 3)},
+                  randomIn(0, 2 * pi));
+    r.precalc(mat23());
+    return r;
+}
+
+template <typename T1, typename T2> struct dataset {
+    std::vector<T1> first;
+    std::vector<T2> second;
+};
+
+// Pairs are sampled around each other and classified by collisionPrimitives
+// itself, so hits and misses are exactly what the narrowphase reports. Pair
+// types that never report a hit end up with a lower ratio than requested.
+template <typename T1, typename T2>
+dataset<T1, T2> makeDataset(std::size_t pairs, double ratio) {
+    std::size_t hitsWanted = pairs * ratio;
+    std::size_t missesWanted = pairs - hitsWanted;
+    std::vector<std::pair<T1, T2>> hits, misses;
+
+    collisionPrimitivesPoint point;
+    for (std::size_t attempt = 0;
+         attempt < pairs * 50 &&
+         (hits.size() < hitsWanted || misses.size() < missesWanted);
+         attempt++) {
+        vec2d pos1(randomIn(-100, 100), randomIn(-100, 100));
+        vec2d pos2 = pos1 + vec2d(randomIn(0, 2 * pi)) * randomIn(0, 4);
+        T1 p1 = makePrimitive<T1>(pos1);
+        T2 p2 = makePrimitive<T2>(pos2);
+
+        if (collisionPrimitives(p1, p2, point)) {
+            if (hits.size() < hitsWanted)
+                hits.push_back({p1, p2});
+        } else if (misses.size() < missesWanted)
+            misses.push_back({p1, p2});
+    }
+    while (hits.size() + misses.size() < pairs) {
+        vec2d pos(randomIn(-100, 100), randomIn(-100, 100));
+        misses.push_back({makePrimitive<T1>(pos),
+                          makePrimitive<T2>(pos + vec2d(1000, 1000))});
+    }
+
+    std::vector<std::pair<T1, T2>> all = hits;
+    all.insert(end(all), begin(misses), end(misses));
+    std::shuffle(begin(all), end(all), gen);
+
+    dataset<T1, T2> result;
+    for (const auto &p : all) {
+        result.first.push_back(p.first);
+        result.second.push_back(p.second);
+    }
+    return result;
+}
+
+void report(const std::string &name, std::size_t pairs, double sec,
+            std::size_t hits) {
+    std::printf("%-28s %14.0f %10.2f %10.3f\n", name.c_str(), pairs / sec,
+                sec / pairs * 1e9, double(hits) / pairs);
+}
+
+template <typename T1, typename T2>
+void benchPair(const std::string &name, std::size_t pairs, double ratio) {
+    auto data = makeDataset<T1, T2>(pairs, ratio);
+
+    std::size_t hits = 0;
+    collisionPrimitivesPoint point;
+    double sec = benchRepeat([&]() {
+        hits = 0;
+        for (std::size_t i = 0; i < pairs; i++)
+            hits += collisionPrimitives(data.first[i], data.second[i], point);
+    });
+    report(name, pairs, sec, hits);
+
+    // same pairs through the dispatch table
+    std::vector<const primitive2d *> first, second;
+    for (std::size_t i = 0; i < pairs; i++) {
+        first.push_back(&data.first[i]);
+        second.push_back(&data.second[i]);
+    }
+    sec = benchRepeat([&]() {
+        hits = 0;
+        for (std::size_t i = 0; i < pairs; i++)
+            hits += collisionPrimitives(*first[i], *second[i], point);
+    });
+    report(name + " (dispatch)", pairs, sec, hits);
+
+    // and through the batch kernel of the type pair
+    std::vector<std::uint8_t> batchHits(pairs);
+    std::vector<collisionPrimitivesPoint> points(pairs);
+    sec = benchRepeat([&]() {
+        collisionPrimitives(T1::typeTag, T2::typeTag, first.data(),
+                            second.data(), pairs, batchHits.data(),
+                            points.data());
+        hits = std::count(begin(batchHits), end(batchHits), 1);
+    });
+    report(name + " (batch)", pairs, sec, hits);
+}
+
+// all pair types shuffled together, as world2d::collisionDetection sees them
+void benchMixed(std::size_t pairs, double ratio) {
+    std::size_t perType = pairs / 9 + 1;
+    auto cc = makeDataset<circle2d, circle2d>(perType, ratio);
+    auto cl = makeDataset<circle2d, line2d>(perType, ratio);
+    auto cr = makeDataset<circle2d, rectangle2d>(perType, ratio);
+    auto lc = makeDataset<line2d, circle2d>(perType, ratio);
+    auto ll = makeDataset<line2d, line2d>(perType, ratio);
+    auto lr = makeDataset<line2d, rectangle2d>(perType, ratio);
+    auto rc = makeDataset<rectangle2d, circle2d>(perType, ratio);
+    auto rl = makeDataset<rectangle2d, line2d>(perType, ratio);
+    auto rr = makeDataset<rectangle2d, rectangle2d>(perType, ratio);
+
+    std::vector<std::pair<const primitive2d *, const primitive2d *>> all;
+    auto append = [&all](const auto &data) {
+        for (std::size_t i = 0; i < data.first.size(); i++)
+            all.push_back({&data.first[i], &data.second[i]});
+    };
+    append(cc), append(cl), append(cr), append(lc), append(ll), append(lr),
+        append(rc), append(rl), append(rr);
+    std::shuffle(begin(all), end(all), gen);
+
+    std::size_t hits = 0;
+    collisionPrimitivesPoint point;
+    double sec = benchRepeat([&]() {
+        hits = 0;
+        for (const auto &p : all)
+            hits += collisionPrimitives(*p.first, *p.second, point);
+    });
+    report("mixed (dispatch)", all.size(), sec, hits);
+
+    // grouped by type pair inside the timed region, like world2d does
+    constexpr std::size_t types = primitiveTypesNumber;
+    std::vector<const primitive2d *> first(all.size()), second(all.size());
+    std::vector<std::uint8_t> batchHits(all.size());
+    std::vector<collisionPrimitivesPoint> points(all.size());
+    sec = benchRepeat([&]() {
+        std::array<std::size_t, types * types + 1> offsets{};
+        for (const auto &p : all)
+            offsets[std::size_t(p.first->getType()) * types +
+                    std::size_t(p.second->getType()) + 1]++;
+        for (std::size_t i = 1; i < offsets.size(); i++)
+            offsets[i] += offsets[i - 1];
+        auto fill = offsets;
+        for (const auto &p : all) {
+            std::size_t slot = fill[std::size_t(p.first->getType()) * types +
+                                    std::size_t(p.second->getType())]++;
+            first[slot] = p.first;
+            second[slot] = p.second;
+        }
+        for (std::size_t i = 0; i < types * types; i++) {
+            std::size_t begin = offsets[i];
+            collisionPrimitives(PrimitiveType(i / types),
+                                PrimitiveType(i % types), &first[begin],
+                                &second[begin], offsets[i + 1] - begin,
+                                &batchHits[begin], &points[begin]);
+        }
+        hits = std::count(begin(batchHits), end(batchHits), 1);
+    });
+    report("mixed (batched)", all.size(), sec, hits);
+}
+
+// circle/circle structure of arrays kernel on every supported level, on
+// ready arrays and with the gather from primitive pointers and the scatter
+// back to pair slots a batch of the world path would need
+void benchCircles(std::size_t pairs, double ratio) {
+    auto data = makeDataset<circle2d, circle2d>(pairs, ratio);
+    circlePairs2d soa;
+    for (std::size_t i = 0; i < pairs; i++)
+        soa.push(data.first[i], data.second[i]);
+
+    std::vector<std::uint32_t> indices(pairs);
+    std::vector<collisionPrimitivesPoint> points(pairs);
+    const char *names[] = {"scalar", "sse2", "avx2"};
+    for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+        if (level > simdLevel())
+            break;
+        std::size_t hits = 0;
+        double sec = benchRepeat([&]() {
+            hits = collisionCircles(soa, indices.data(), points.data(), level);
+        });
+        report(std::string("circle/circle (") + names[int(level)] + ")",
+               pairs, sec, hits);
+    }
+
+    std::vector<const primitive2d *> first, second;
+    for (std::size_t i = 0; i < pairs; i++) {
+        first.push_back(&data.first[i]);
+        second.push_back(&data.second[i]);
+    }
+    std::vector<std::uint8_t> batchHits(pairs);
+    std::size_t hits = 0;
+    double sec = benchRepeat([&]() {
+        soa.resize(pairs);
+        for (std::size_t i = 0; i < pairs; i++) {
+            const auto &c1 = static_cast<const circle2d &>(*first[i]);
+            const auto &c2 = static_cast<const circle2d &>(*second[i]);
+            soa.x1[i] = c1.getPos().x(), soa.y1[i] = c1.getPos().y();
+            soa.r1[i] = c1.getRadius();
+            soa.x2[i] = c2.getPos().x(), soa.y2[i] = c2.getPos().y();
+            soa.r2[i] = c2.getRadius();
+        }
+        hits = collisionCircles(soa, indices.data(), points.data());
+        std::fill(begin(batchHits), end(batchHits), 0);
+        for (std::size_t k = hits; k-- > 0;) {
+            batchHits[indices[k]] = 1;
+            points[indices[k]] = points[k];
+        }
+    });
+    report(std::string("circle/circle (gather+") + names[int(simdLevel())] +
+               ")",
+           pairs, sec, hits);
+}
+
+void benchAll(std::size_t pairs, double ratio) {
+    std::printf("\nrequested hit ratio %.2f, %zu pairs\n", ratio, pairs);
+    std::printf("%-28s %14s %10s %10s\n", "pair", "pairs/sec", "ns/pair",
+                "hit ratio");
+
+    benchPair<circle2d, circle2d>("circle/circle", pairs, ratio);
+    benchCircles(pairs, ratio);
+    benchPair<circle2d, line2d>("circle/line", pairs, ratio);
+    benchPair<circle2d, rectangle2d>("circle/rect", pairs, ratio);
+    benchPair<line2d, circle2d>("line/circle", pairs, ratio);
+    benchPair<line2d, line2d>("line/line", pairs, ratio);
+    benchPair<line2d, rectangle2d>("line/rect", pairs, ratio);
+    benchPair<rectangle2d, circle2d>("rect/circle", pairs, ratio);
+    benchPair<rectangle2d, line2d>("rect/line", pairs, ratio);
+    benchPair<rectangle2d, rectangle2d>("rect/rect", pairs, ratio);
+    benchMixed(pairs, ratio);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    benchArgs args(argc, argv);
+    std::size_t pairs = args.get("pairs", 4096);
+    double ratio = args.get("ratio", -1);
+    gen.seed(args.get("seed", 1));
+
+    if (ratio < 0)
+        for (double r : {0.1, 0.5, 0.9})
+            benchAll(pairs, r);
+    else
+        benchAll(pairs, ratio);
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "bench.h"
+#include "world2d.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Steps a GLWidget::initializeGL like scene headless and times every phase
+// of the frame as paintGL runs them.
+//   counts=10,100,1000,10000   object numbers, one run per number
+//   frames=10
+//   warmup=0          untimed frames before, the spawned bricks overlap and
+//                     the first frames mostly push them apart
+//   broadphase=all    kdtree, aabbtree, bvh, sap, hash,
+//                     twolevel
+//   threads=0         world threads, 0 takes every hardware thread
+//   graph=0           1 runs every frame as the world2d::step task graph,
+//                     then only the whole frame is timed
+//   sleep=1           0 keeps every object awake
+//   shapes=circles    mixed turns every second brick into a rectangle or a
+//                     four line outline, for all narrowphase pair types
+//   seed=1
+
+namespace {
+
+// circle grid bricks inside four fixed walls, the area grows with the
+// object number to keep the density of the demo scene
+void spawnScene(world2d &world, std::size_t count, bool mixed,
+                unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    real scale = std::sqrt(count / 5.0);
+
+    for (std::size_t n = 0; n < count; n++) {
+        real pos_x = (dis(gen) * 60 - 30) * scale;
+        real pos_y = (dis(gen) * 60 - 30) * scale;
+        real angle = dis(gen) * 2 * pi;
+
+        real speedX = dis(gen) * 0.1 - 0.05;
+        real speedY = dis(gen) * 0.1 - 0.05;
+        real speedAngle = dis(gen) * 0.001 - 0.0005;
+
+        real width = 5 + dis(gen) * 20;
+        real height = 5 + dis(gen) * 20;
+        int grid_size_x = width * 0.5;
+        int grid_size_y = height * 0.5;
+
+        object2d *object = new object2d();
+        if (mixed && n % 4 == 1)
+            object->add(new rectangle2d({0, 0}, {width, height}, 0));
+        else if (mixed && n % 4 == 3) {
+            vec2d corners[] = {{-width / 2, -height / 2},
+                               {width / 2, -height / 2},
+                               {width / 2, height / 2},
+                               {-width / 2, height / 2}};
+            for (int i = 0; i < 4; i++)
+                object->add(new line2d(corners[i], corners[(i + 1) % 4]));
+        } else
+            for (int i = 0; i < grid_size_x; i++)
+                for (int j = 0; j < grid_size_y; j++) {
+                    object->add(new circle2d(
+                        {-width / 2 + i * (width / grid_size_x),
+                         -height / 2 + j * (height / grid_size_y)},
+                        std::min(width / grid_size_x, height / grid_size_y) /
+                            2));
+                }
+        object->setPos({pos_x, pos_y});
+        object->setAngle(angle);
+        object->setSpeed({speedX, speedY});
+        object->setAngleSpeed(speedAngle);
+        object->setWeight(width * height);
+        object->setWeightDistrib(vec2d(width / 2, height / 2).length());
+        world.addObject(object);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        object2d *object = new object2d();
+        object->add(new rectangle2d({0, 0}, {5, 90 * scale}, pi / 2 * i));
+        object->setPos(vec2d(pi / 2 * i) * (50 * scale));
+        object->setIsFixed(true);
+        world.addObject(object);
+    }
+}
+
+// the same fixed step paintGL gets at 100 fps
+constexpr double sec = 10;
+
+void step(world2d &world) {
+    world.update(sec);
+    world.precalc();
+    world.collisionDetection();
+    world.collisionResolve();
+}
+
+void benchScene(const std::string &name, BroadphaseType type,
+                std::size_t count, std::size_t frames, std::size_t warmup,
+                std::size_t threads, bool graph, bool sleep, bool mixed,
+                unsigned seed) {
+    world2d world;
+    world.setBroadphase(type);
+    world.setThreads(threads);
+    world.setSleeping(sleep);
+    spawnScene(world, count, mixed, seed);
+    for (std::size_t frame = 0; frame < warmup; frame++)
+        step(world);
+
+    double updateSec = 0, precalcSec = 0, detectionSec = 0, resolveSec = 0;
+    benchTimer total, phase;
+    for (std::size_t frame = 0; frame < frames && graph; frame++)
+        world.step(sec);
+    for (std::size_t frame = 0; frame < frames && !graph; frame++) {
+        phase.restart();
+        world.update(sec);
+        updateSec += phase.elapsed();
+
+        phase.restart();
+        world.precalc();
+        precalcSec += phase.elapsed();
+
+        phase.restart();
+        world.collisionDetection();
+        detectionSec += phase.elapsed();
+
+        phase.restart();
+        world.collisionResolve();
+        resolveSec += phase.elapsed();
+    }
+    double totalSec = total.elapsed();
+
+    std::size_t asleep = 0;
+    for (auto object : world.getObjects())
+        asleep += object->getIsSleeping();
+
+    std::printf("%-10s %8zu %10.3f %10.3f %10.3f %10.3f %10.3f %10.1f "
+                "%10.1f %8zu\n",
+                name.c_str(), count, updateSec / frames * 1e3,
+                precalcSec / frames * 1e3, detectionSec / frames * 1e3,
+                resolveSec / frames * 1e3, totalSec / frames * 1e3,
+                frames / totalSec, peakRSS() / (1024.0 * 1024.0), asleep);
+
+    for (auto object : world.getObjects())
+        delete object;
+    world.destroy();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    benchArgs args(argc, argv);
+    std::size_t frames = args.get("frames", 10);
+    std::size_t warmup = args.get("warmup", 0);
+    std::string broadphase = args.get("broadphase", std::string("all"));
+    std::size_t threads = args.get("threads", 0);
+    bool graph = args.get("graph", 0);
+    bool sleep = args.get("sleep", 1);
+    bool mixed = args.get("shapes", std::string("circles")) == "mixed";
+    unsigned seed = args.get("seed", 1);
+
+    std::vector<std::size_t> counts;
+    std::stringstream list(
+        args.get("counts", std::string("10,100,1000,10000")));
+    for (std::string item; std::getline(list, item, ',');)
+        counts.push_back(std::stoul(item));
+
+    std::printf("ms per frame, %zu frames after %zu warmup, peak RSS of the "
+                "process\n",
+                frames, warmup);
+    std::printf("%-10s %8s %10s %10s %10s %10s %10s %10s %10s %8s\n",
+                "broadphase", "objects", "update", "precalc", "detection",
+                "resolve", "frame", "fps", "RSS MiB", "asleep");
+    for (const auto &[name, type] : broadphaseTypes())
+        if (broadphase == "all" || broadphase == name)
+            for (auto count : counts)
+                benchScene(name, type, count, frames, warmup, threads, graph,
+                           sleep, mixed, seed);
+
+    return 0;
+}
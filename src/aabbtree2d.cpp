@@ -0,0 +1,395 @@
+#include "aabbtree2d.h"
+#include <algorithm>
+
+AABBTree2d::AABBTree2d(real margin) : margin(margin) {}
+
+bBox AABBTree2d::fatten(const bBox &bbox) const {
+    return bBox(bbox.getMinX() - margin, bbox.getMinY() - margin,
+                bbox.getMaxX() + margin, bbox.getMaxY() + margin);
+}
+
+std::uint64_t AABBTree2d::pairKey(std::int32_t leaf1, std::int32_t leaf2) {
+    if (leaf1 > leaf2)
+        std::swap(leaf1, leaf2);
+    return std::uint64_t(leaf1) << 32 | std::uint32_t(leaf2);
+}
+
+std::pair<Item, Item> AABBTree2d::makePair(std::uint64_t key) const {
+    const Item &item1 = nodes[key >> 32].item;
+    const Item &item2 = nodes[key & 0xffffffff].item;
+    if (item1.object < item2.object)
+        return {item1, item2};
+    return {item2, item1};
+}
+
+// ----------------------
+// tree
+// ----------------------
+
+std::int32_t AABBTree2d::allocateNode() {
+    if (freeList == nullNode) {
+        nodes.push_back(Node());
+        return nodes.size() - 1;
+    }
+
+    std::int32_t index = freeList;
+    freeList = nodes[index].parent;
+    nodes[index] = Node();
+    return index;
+}
+
+// item is kept to report removed pairs of destroyed leaves
+void AABBTree2d::freeNode(std::int32_t index) {
+    nodes[index].parent = freeList;
+    nodes[index].height = -1;
+    freeList = index;
+}
+
+void AABBTree2d::insertLeaf(std::int32_t leaf) {
+    if (root == nullNode) {
+        root = leaf;
+        nodes[root].parent = nullNode;
+        return;
+    }
+
+    // descend to the sibling with the smallest perimeter growth
+    bBox leafBBox = nodes[leaf].bbox;
+    std::int32_t index = root;
+    while (!nodes[index].isLeaf()) {
+        real perimeter = nodes[index].bbox.perimeter();
+        real combinedPerimeter = (nodes[index].bbox + leafBBox).perimeter();
+
+        // new parent for this node and the leaf
+        real cost = 2 * combinedPerimeter;
+        // growth of this node if the leaf goes further down
+        real inheritanceCost = 2 * (combinedPerimeter - perimeter);
+
+        auto childCost = [&](std::int32_t child) {
+            real cost = (nodes[child].bbox + leafBBox).perimeter();
+            if (!nodes[child].isLeaf())
+                cost -= nodes[child].bbox.perimeter();
+            return cost + inheritanceCost;
+        };
+        real cost1 = childCost(nodes[index].child1);
+        real cost2 = childCost(nodes[index].child2);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+        index = cost1 < cost2 ? nodes[index].child1 : nodes[index].child2;
+    }
+
+    std::int32_t sibling = index;
+    std::int32_t oldParent = nodes[sibling].parent;
+    std::int32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].bbox = leafBBox + nodes[sibling].bbox;
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == nullNode)
+        root = newParent;
+    else if (nodes[oldParent].child1 == sibling)
+        nodes[oldParent].child1 = newParent;
+    else
+        nodes[oldParent].child2 = newParent;
+
+    fixUpwards(nodes[leaf].parent);
+}
+
+void AABBTree2d::removeLeaf(std::int32_t leaf) {
+    if (leaf == root) {
+        root = nullNode;
+        return;
+    }
+
+    std::int32_t parent = nodes[leaf].parent;
+    std::int32_t grandParent = nodes[parent].parent;
+    std::int32_t sibling = nodes[parent].child1 == leaf
+                               ? nodes[parent].child2
+                               : nodes[parent].child1;
+
+    if (grandParent == nullNode) {
+        root = sibling;
+        nodes[sibling].parent = nullNode;
+        freeNode(parent);
+        return;
+    }
+
+    if (nodes[grandParent].child1 == parent)
+        nodes[grandParent].child1 = sibling;
+    else
+        nodes[grandParent].child2 = sibling;
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    fixUpwards(grandParent);
+}
+
+void AABBTree2d::fixUpwards(std::int32_t index) {
+    while (index != nullNode) {
+        index = balance(index);
+
+        Node &node = nodes[index];
+        node.height =
+            1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+        node.bbox = nodes[node.child1].bbox + nodes[node.child2].bbox;
+
+        index = node.parent;
+    }
+}
+
+// Rotates the higher child of a up if the subtree is unbalanced, returns the
+// new subtree root
+std::int32_t AABBTree2d::balance(std::int32_t iA) {
+    Node &a = nodes[iA];
+    if (a.isLeaf() || a.height < 2)
+        return iA;
+
+    std::int32_t iB = a.child1;
+    std::int32_t iC = a.child2;
+    std::int32_t diff = nodes[iC].height - nodes[iB].height;
+    if (diff >= -1 && diff <= 1)
+        return iA;
+
+    // up is the higher child, it takes place of a
+    bool rotateC = diff > 1;
+    std::int32_t iUp = rotateC ? iC : iB;
+    std::int32_t iOther = rotateC ? iB : iC;
+    Node &up = nodes[iUp];
+
+    std::int32_t iF = up.child1;
+    std::int32_t iG = up.child2;
+
+    up.child1 = iA;
+    up.parent = a.parent;
+    a.parent = iUp;
+    if (up.parent == nullNode)
+        root = iUp;
+    else if (nodes[up.parent].child1 == iA)
+        nodes[up.parent].child1 = iUp;
+    else
+        nodes[up.parent].child2 = iUp;
+
+    // the higher grandchild stays with up, the lower one goes to a
+    std::int32_t iKeep = nodes[iF].height > nodes[iG].height ? iF : iG;
+    std::int32_t iMove = iKeep == iF ? iG : iF;
+
+    up.child2 = iKeep;
+    if (rotateC)
+        a.child2 = iMove;
+    else
+        a.child1 = iMove;
+    nodes[iMove].parent = iA;
+
+    a.bbox = nodes[iOther].bbox + nodes[iMove].bbox;
+    a.height = 1 + std::max(nodes[iOther].height, nodes[iMove].height);
+    up.bbox = a.bbox + nodes[iKeep].bbox;
+    up.height = 1 + std::max(a.height, nodes[iKeep].height);
+
+    return iUp;
+}
+
+template <typename F> void AABBTree2d::query(const bBox &bbox, F &&callback) {
+    if (root == nullNode)
+        return;
+
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty()) {
+        std::int32_t index = stack.back();
+        stack.pop_back();
+
+        const Node &node = nodes[index];
+        if (!node.bbox.intersect(bbox))
+            continue;
+
+        if (node.isLeaf())
+            callback(index);
+        else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+// ----------------------
+// proxies
+// ----------------------
+
+std::int32_t AABBTree2d::createProxy(const Item &item) {
+    std::int32_t leaf = allocateNode();
+    nodes[leaf].item = item;
+    nodes[leaf].bbox = fatten(item.bbox);
+    nodes[leaf].moved = true;
+    insertLeaf(leaf);
+    moveBuffer.push_back(leaf);
+    return leaf;
+}
+
+void AABBTree2d::destroyProxy(std::int32_t leaf) {
+    removeLeaf(leaf);
+    freeNode(leaf);
+}
+
+void AABBTree2d::moveProxy(std::int32_t leaf, const Item &item) {
+    nodes[leaf].item = item;
+    if (nodes[leaf].bbox.contains(item.bbox))
+        return;
+
+    removeLeaf(leaf);
+    nodes[leaf].bbox = fatten(item.bbox);
+    insertLeaf(leaf);
+
+    if (!nodes[leaf].moved) {
+        nodes[leaf].moved = true;
+        moveBuffer.push_back(leaf);
+    }
+}
+
+// ----------------------
+// broadphase2d
+// ----------------------
+
+void AABBTree2d::update(const std::list<object2d *> &objects) {
+    stamp++;
+    addedPairs.clear();
+    removedPairs.clear();
+
+    // destroy proxies of removed objects and of objects with a changed model
+    for (auto object : objects) {
+        auto it = proxies.find(object);
+        if (it == proxies.end())
+            continue;
+
+        if (it->second.leaves.size() ==
+            object->getCollisionModel_precalc().size())
+            it->second.stamp = stamp;
+        else {
+            for (auto leaf : it->second.leaves)
+                destroyProxy(leaf);
+            proxies.erase(it);
+        }
+    }
+    for (auto it = proxies.begin(); it != proxies.end();)
+        if (it->second.stamp != stamp) {
+            for (auto leaf : it->second.leaves)
+                destroyProxy(leaf);
+            it = proxies.erase(it);
+        } else
+            it++;
+
+    // before the freed leaves are reused
+    std::erase_if(pairs, [this](std::uint64_t key) {
+        if (nodes[key >> 32].height >= 0 && nodes[key & 0xffffffff].height >= 0)
+            return false;
+        removedPairs.push_back(makePair(key));
+        return true;
+    });
+
+    for (auto object : objects) {
+        auto [it, inserted] = proxies.try_emplace(object);
+        it->second.stamp = stamp;
+        if (!inserted && object->getIsSleeping())
+            continue; // the proxies did not move
+
+        const auto &model = object->getCollisionModel_precalc();
+        const auto &bboxes = object->getCollisionModel_bBoxes();
+        for (std::size_t i = 0; i < model.size(); i++) {
+            Item item{bboxes[i], object, model[i]};
+            if (inserted)
+                it->second.leaves.push_back(createProxy(item));
+            else
+                moveProxy(it->second.leaves[i], item);
+        }
+    }
+
+    std::erase_if(pairs, [this](std::uint64_t key) {
+        const Node &node1 = nodes[key >> 32];
+        const Node &node2 = nodes[key & 0xffffffff];
+        if ((!node1.moved && !node2.moved) || node1.bbox.intersect(node2.bbox))
+            return false;
+        removedPairs.push_back(makePair(key));
+        return true;
+    });
+
+    // only reinserted leaves can start new pairs
+    newPairs.clear();
+    for (auto leaf : moveBuffer)
+        query(nodes[leaf].bbox, [this, leaf](std::int32_t other) {
+            // pair of two moved leaves is reported by the smaller one
+            if (other == leaf ||
+                nodes[other].item.object == nodes[leaf].item.object ||
+                (nodes[other].moved && other < leaf))
+                return;
+            newPairs.push_back(pairKey(leaf, other));
+        });
+    std::sort(begin(newPairs), end(newPairs));
+
+    auto oldEnd = pairs.size();
+    for (auto key : newPairs)
+        if (!std::binary_search(begin(pairs), begin(pairs) + oldEnd, key)) {
+            pairs.push_back(key);
+            addedPairs.push_back(makePair(key));
+        }
+    std::inplace_merge(begin(pairs), begin(pairs) + oldEnd, end(pairs));
+
+    for (auto leaf : moveBuffer)
+        nodes[leaf].moved = false;
+    moveBuffer.clear();
+}
+
+void AABBTree2d::findPairs(std::vector<std::pair<Item, Item>> &result) {
+    for (auto key : pairs) {
+        const Item &item1 = nodes[key >> 32].item;
+        const Item &item2 = nodes[key & 0xffffffff].item;
+        if (item1.bbox.intersect(item2.bbox))
+            result.push_back(makePair(key));
+    }
+}
+
+void AABBTree2d::intersect(const bBox &bbox, std::vector<Item> &result) {
+    query(bbox, [this, &bbox, &result](std::int32_t leaf) {
+        if (nodes[leaf].item.bbox.intersect(bbox))
+            result.push_back(nodes[leaf].item);
+    });
+}
+
+void AABBTree2d::precalcDebug_VBO(std::vector<float> &vertices) {
+    for (const auto &node : nodes)
+        if (node.height >= 0)
+            pushBBoxVertices(vertices, node.bbox);
+}
+
+const std::vector<std::pair<Item, Item>> &AABBTree2d::getAddedPairs() const {
+    return addedPairs;
+}
+const std::vector<std::pair<Item, Item>> &
+AABBTree2d::getRemovedPairs() const {
+    return removedPairs;
+}
+
+std::size_t AABBTree2d::memoryUsage() const {
+    std::size_t proxiesSize = 0;
+    for (const auto &[object, objectProxies] : proxies)
+        proxiesSize += sizeof(object) + sizeof(objectProxies) +
+                       objectProxies.leaves.capacity() * sizeof(std::int32_t);
+
+    return nodes.capacity() * sizeof(Node) + proxiesSize +
+           (pairs.capacity() + newPairs.capacity()) * sizeof(std::uint64_t) +
+           (moveBuffer.capacity() + stack.capacity()) * sizeof(std::int32_t);
+}
+
+std::size_t AABBTree2d::nodeCount() const {
+    std::size_t count = 0;
+    for (const auto &node : nodes)
+        if (node.height >= 0)
+            count++;
+    return count;
+}
+
+std::int32_t AABBTree2d::height() const {
+    return root == nullNode ? 0 : nodes[root].height;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "broadphase2d.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Incremental dynamic AABB tree. Every primitive owns a leaf with a box
+// fattened by margin, a leaf is reinserted only when the tight box leaves
+// the fat one. Overlapping leaves are kept as persistent pairs which are
+// updated only for reinserted leaves.
+class AABBTree2d : public broadphase2d {
+    static constexpr std::int32_t nullNode = -1;
+
+    struct Node {
+        bBox bbox;                      // fattened for leaves
+        std::int32_t parent = nullNode; // next free node when unused
+        std::int32_t child1 = nullNode;
+        std::int32_t child2 = nullNode;
+        std::int32_t height = 0; // 0 leaf, -1 free
+        Item item;               // leaves only, tight box
+        bool moved = false;
+
+        bool isLeaf() const { return child1 == nullNode; }
+    };
+
+    struct ObjectProxies {
+        std::vector<std::int32_t> leaves; // in collisionModel order
+        std::size_t stamp = 0;
+    };
+
+    real margin;
+    std::vector<Node> nodes;
+    std::int32_t root = nullNode;
+    std::int32_t freeList = nullNode;
+
+    std::unordered_map<object2d *, ObjectProxies> proxies;
+    std::size_t stamp = 0;
+
+    std::vector<std::int32_t> moveBuffer;
+    std::vector<std::uint64_t> pairs; // sorted, leaf1 < leaf2
+    std::vector<std::uint64_t> newPairs;
+    std::vector<std::int32_t> stack;
+
+    std::vector<std::pair<Item, Item>> addedPairs;
+    std::vector<std::pair<Item, Item>> removedPairs;
+
+    std::int32_t allocateNode();
+    void freeNode(std::int32_t index);
+    void insertLeaf(std::int32_t leaf);
+    void removeLeaf(std::int32_t leaf);
+    std::int32_t balance(std::int32_t index);
+    void fixUpwards(std::int32_t index);
+    template <typename F> void query(const bBox &bbox, F &&callback);
+
+    std::int32_t createProxy(const Item &item);
+    void destroyProxy(std::int32_t leaf);
+    void moveProxy(std::int32_t leaf, const Item &item);
+
+    bBox fatten(const bBox &bbox) const;
+    std::pair<Item, Item> makePair(std::uint64_t key) const;
+    static std::uint64_t pairKey(std::int32_t leaf1, std::int32_t leaf2);
+
+  public:
+    AABBTree2d(real margin = 1.0);
+    AABBTree2d(const AABBTree2d &) = delete;
+    AABBTree2d &operator=(const AABBTree2d &) = delete;
+
+    void update(const std::list<object2d *> &objects) override;
+    void findPairs(std::vector<std::pair<Item, Item>> &result) override;
+    void intersect(const bBox &bbox, std::vector<Item> &result) override;
+    void precalcDebug_VBO(std::vector<float> &vertices) override;
+    std::size_t memoryUsage() const override;
+
+    // pairs whose fat boxes started/stopped overlapping in the last update.
+    // Primitives of removed pairs may be already destroyed, compare only.
+    const std::vector<std::pair<Item, Item>> &getAddedPairs() const;
+    const std::vector<std::pair<Item, Item>> &getRemovedPairs() const;
+
+    std::size_t nodeCount() const;
+    std::int32_t height() const;
+};
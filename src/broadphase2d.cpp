@@ -0,0 +1,80 @@
+#include "broadphase2d.h"
+#include "aabbtree2d.h"
+#include "bvh2d.h"
+#include "kdtree2d.h"
+#include "spatialhash2d.h"
+#include "sweepandprune2d.h"
+#include "twolevel2d.h"
+
+broadphase2d *broadphase2d::create(BroadphaseType type) {
+    switch (type) {
+    case BroadphaseType::KDTree:
+        return new KDTreeBroadphase2d();
+    case BroadphaseType::AABBTree:
+        return new AABBTree2d();
+    case BroadphaseType::BVH:
+        return new BVH2d();
+    case BroadphaseType::SweepAndPrune:
+        return new SweepAndPrune2d();
+    case BroadphaseType::SpatialHash:
+        return new SpatialHash2d();
+    case BroadphaseType::TwoLevel:
+        return new TwoLevel2d();
+    }
+    return nullptr;
+}
+
+void broadphase2d::setThreadPool(threadPool2d *newPool) { pool = newPool; }
+
+KDTreeBroadphase2d::~KDTreeBroadphase2d() { delete kdtree; }
+
+void KDTreeBroadphase2d::update(const std::list<object2d *> &objects) {
+    bBox bbox;
+    bool bboxInit = false;
+    for (auto object : objects) {
+        if (bboxInit)
+            bbox += object->getBBox();
+        else {
+            bbox = object->getBBox();
+            bboxInit = true;
+        }
+    }
+
+    // in the order object2d::precalcCollisionModel_KDTree adds them
+    items.clear();
+    for (auto object : objects) {
+        const auto &model = object->getCollisionModel_precalc();
+        const auto &bboxes = object->getCollisionModel_bBoxes();
+        for (std::size_t i = 0; i < model.size(); i++)
+            items.push_back({bboxes[i], object, model[i]});
+    }
+
+    delete kdtree;
+    kdtree = new KDTree2d(bbox);
+    kdtree->build(items, pool, arenas);
+}
+
+void KDTreeBroadphase2d::findPairs(
+    std::vector<std::pair<Item, Item>> &result) {
+    if (kdtree)
+        kdtree->parseTree(result, pool, buffers);
+}
+
+void KDTreeBroadphase2d::intersect(const bBox &bbox,
+                                   std::vector<Item> &result) {
+    if (kdtree)
+        kdtree->intersect(bbox, result);
+}
+
+void KDTreeBroadphase2d::precalcDebug_VBO(std::vector<float> &vertices) {
+    if (kdtree)
+        kdtree->precalcDebug_VBO(vertices);
+}
+
+std::size_t KDTreeBroadphase2d::memoryUsage() const {
+    std::size_t buffersSize = 0;
+    for (const auto &buffer : buffers)
+        buffersSize += buffer.capacity() * sizeof(std::pair<Item, Item>);
+    return (kdtree ? kdtree->memoryUsage() : 0) +
+           items.capacity() * sizeof(Item) + buffersSize;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "object2d.h"
+#include "primitive2d.h"
+#include "threadpool2d.h"
+#include <deque>
+#include <list>
+#include <utility>
+#include <vector>
+
+struct Item {
+    bBox bbox;
+    object2d *object;
+    primitive2d *primitive;
+};
+
+enum class BroadphaseType {
+    KDTree,
+    AABBTree,
+    BVH,
+    SweepAndPrune,
+    SpatialHash,
+    TwoLevel
+};
+
+// Finds candidate primitive pairs for the narrowphase
+class broadphase2d {
+  protected:
+    threadPool2d *pool = nullptr; // serial without one
+
+  public:
+    virtual ~broadphase2d() = default;
+
+    void setThreadPool(threadPool2d *newPool);
+
+    // objects have their collision model precalculated
+    virtual void update(const std::list<object2d *> &objects) = 0;
+    // overlapping pairs of different objects, first.object < second.object,
+    // without duplicates
+    virtual void findPairs(std::vector<std::pair<Item, Item>> &result) = 0;
+    virtual void intersect(const bBox &bbox, std::vector<Item> &result) = 0;
+    virtual void precalcDebug_VBO(std::vector<float> &vertices) = 0;
+    virtual std::size_t memoryUsage() const = 0; // bytes
+
+    static broadphase2d *create(BroadphaseType type);
+};
+
+class KDTree2d;
+
+// KDTree2d rebuilt from scratch on every update
+class KDTreeBroadphase2d : public broadphase2d {
+    KDTree2d *kdtree = nullptr;
+    std::vector<Item> items;
+    std::vector<std::deque<KDTree2d>> arenas;
+    std::vector<std::vector<std::pair<Item, Item>>> buffers;
+
+  public:
+    KDTreeBroadphase2d() = default;
+    KDTreeBroadphase2d(const KDTreeBroadphase2d &) = delete;
+    KDTreeBroadphase2d &operator=(const KDTreeBroadphase2d &) = delete;
+    ~KDTreeBroadphase2d();
+
+    void update(const std::list<object2d *> &objects) override;
+    void findPairs(std::vector<std::pair<Item, Item>> &result) override;
+    void intersect(const bBox &bbox, std::vector<Item> &result) override;
+    void precalcDebug_VBO(std::vector<float> &vertices) override;
+    std::size_t memoryUsage() const override;
+};
@@ -0,0 +1,312 @@
+#include "bvh2d.h"
+#include "object2d.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// the nearest float not inside the double range
+float roundDown(double value) {
+    float result = float(value);
+    if (result > value)
+        result =
+            std::nextafter(result, -std::numeric_limits<float>::infinity());
+    return result;
+}
+
+float roundUp(double value) {
+    float result = float(value);
+    if (result < value)
+        result =
+            std::nextafter(result, std::numeric_limits<float>::infinity());
+    return result;
+}
+
+} // namespace
+
+BVH2d::Box::Box(const bBox &bbox)
+    : minX(roundDown(bbox.getMinX())), minY(roundDown(bbox.getMinY())),
+      maxX(roundUp(bbox.getMaxX())), maxY(roundUp(bbox.getMaxY())) {}
+
+BVH2d::Box BVH2d::Box::operator+(const Box &other) const {
+    Box result;
+    result.minX = std::min(minX, other.minX);
+    result.minY = std::min(minY, other.minY);
+    result.maxX = std::max(maxX, other.maxX);
+    result.maxY = std::max(maxY, other.maxY);
+    return result;
+}
+
+bool BVH2d::Box::intersect(const Box &other) const {
+    return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY &&
+           other.minY <= maxY;
+}
+
+float BVH2d::Box::perimeter() const { return 2 * (maxX - minX + maxY - minY); }
+
+// ----------------------
+// build
+// ----------------------
+
+void BVH2d::build(const std::vector<Item> &newItems) {
+    nodes.clear();
+    items.clear();
+    boxes.clear();
+    if (newItems.empty())
+        return;
+
+    std::uint32_t count = newItems.size();
+    buildBoxes.resize(count);
+    centers.resize(2 * count);
+    for (std::uint32_t i = 0; i < count; i++) {
+        Box &box = buildBoxes[i];
+        box = Box(newItems[i].bbox);
+        centers[2 * i] = (box.minX + box.maxX) * 0.5f;
+        centers[2 * i + 1] = (box.minY + box.maxY) * 0.5f;
+    }
+    order.resize(count);
+    std::iota(begin(order), end(order), 0);
+
+    nodes.reserve(2 * count / leafSizeMax + 1);
+    nodes.push_back(Node());
+    build(0, 0, count);
+
+    // leaves refer to contiguous ranges of the reordered items
+    items.reserve(count);
+    boxes.reserve(count);
+    for (auto i : order) {
+        items.push_back(newItems[i]);
+        boxes.push_back(buildBoxes[i]);
+    }
+}
+
+// binned SAH split on the longer axis of the centers, perimeter as the cost
+void BVH2d::build(std::uint32_t node, std::uint32_t begin, std::uint32_t end) {
+    Box box = buildBoxes[order[begin]];
+    float centerMin[2] = {centers[2 * order[begin]],
+                          centers[2 * order[begin] + 1]};
+    float centerMax[2] = {centerMin[0], centerMin[1]};
+    for (std::uint32_t i = begin + 1; i < end; i++) {
+        box = box + buildBoxes[order[i]];
+        for (int axis = 0; axis < 2; axis++) {
+            centerMin[axis] =
+                std::min(centerMin[axis], centers[2 * order[i] + axis]);
+            centerMax[axis] =
+                std::max(centerMax[axis], centers[2 * order[i] + axis]);
+        }
+    }
+    nodes[node].box = box;
+
+    std::uint32_t count = end - begin;
+    int axis = centerMax[0] - centerMin[0] >= centerMax[1] - centerMin[1]
+                   ? 0
+                   : 1;
+    float extent = centerMax[axis] - centerMin[axis];
+    auto makeLeaf = [&]() {
+        nodes[node].index = begin;
+        nodes[node].count = count;
+    };
+    if (count == 1 || (count <= leafSizeMax && extent <= 0)) {
+        makeLeaf();
+        return;
+    }
+
+    std::uint32_t middle = begin;
+    if (extent > 0) {
+        float scale = binsNumber / extent;
+        auto binOf = [&](std::uint32_t item) {
+            std::size_t bin = (centers[2 * item + axis] - centerMin[axis]) *
+                              scale;
+            return std::min(bin, binsNumber - 1);
+        };
+
+        Box binBoxes[binsNumber];
+        std::uint32_t binCounts[binsNumber] = {};
+        for (std::uint32_t i = begin; i < end; i++) {
+            std::size_t bin = binOf(order[i]);
+            const Box &itemBox = buildBoxes[order[i]];
+            binBoxes[bin] =
+                binCounts[bin]++ ? binBoxes[bin] + itemBox : itemBox;
+        }
+
+        // cost of splitting after every bin but the last
+        float costs[binsNumber - 1];
+        Box sweepBox;
+        std::uint32_t sweepCount = 0;
+        for (std::size_t bin = 0; bin + 1 < binsNumber; bin++) {
+            if (binCounts[bin])
+                sweepBox = sweepCount ? sweepBox + binBoxes[bin]
+                                      : binBoxes[bin];
+            sweepCount += binCounts[bin];
+            costs[bin] = sweepCount ? sweepCount * sweepBox.perimeter() : 0;
+        }
+        sweepCount = 0;
+        for (std::size_t bin = binsNumber - 1; bin > 0; bin--) {
+            if (binCounts[bin])
+                sweepBox = sweepCount ? sweepBox + binBoxes[bin]
+                                      : binBoxes[bin];
+            sweepCount += binCounts[bin];
+            costs[bin - 1] += sweepCount ? sweepCount * sweepBox.perimeter()
+                                         : 0;
+        }
+
+        std::size_t split =
+            std::min_element(costs, costs + binsNumber - 1) - costs;
+        if (count <= leafSizeMax && count * box.perimeter() <= costs[split]) {
+            makeLeaf();
+            return;
+        }
+
+        middle = std::partition(order.begin() + begin, order.begin() + end,
+                                [&](std::uint32_t item) {
+                                    return binOf(item) <= split;
+                                }) -
+                 order.begin();
+    }
+
+    // equal centers, split by count
+    if (middle == begin || middle == end) {
+        middle = begin + count / 2;
+        std::nth_element(order.begin() + begin, order.begin() + middle,
+                         order.begin() + end,
+                         [&](std::uint32_t item1, std::uint32_t item2) {
+                             return centers[2 * item1 + axis] <
+                                    centers[2 * item2 + axis];
+                         });
+    }
+
+    // the first child always follows its parent
+    nodes.push_back(Node());
+    build(node + 1, begin, middle);
+    std::uint32_t second = nodes.size();
+    nodes.push_back(Node());
+    build(second, middle, end);
+    nodes[node].index = second;
+    nodes[node].count = 0;
+}
+
+// ----------------------
+// queries
+// ----------------------
+
+void BVH2d::pushPair(std::uint32_t item1, std::uint32_t item2,
+                     std::vector<std::pair<Item, Item>> &result) const {
+    if (items[item1].object == items[item2].object ||
+        !boxes[item1].intersect(boxes[item2]))
+        return;
+
+    if (items[item1].object < items[item2].object)
+        result.push_back({items[item1], items[item2]});
+    else
+        result.push_back({items[item2], items[item1]});
+}
+
+void BVH2d::parseNode(std::uint32_t node,
+                      std::vector<std::pair<Item, Item>> &result) const {
+    const Node &n = nodes[node];
+    if (n.isLeaf()) {
+        for (std::uint32_t i = n.index; i < n.index + n.count; i++)
+            for (std::uint32_t j = i + 1; j < n.index + n.count; j++)
+                pushPair(i, j, result);
+        return;
+    }
+
+    parseNode(node + 1, result);
+    parseNode(n.index, result);
+    parseNodes(node + 1, n.index, result);
+}
+
+// every item of node1 against every item of node2, the subtrees are disjoint
+// so each pair is found once
+void BVH2d::parseNodes(std::uint32_t node1, std::uint32_t node2,
+                       std::vector<std::pair<Item, Item>> &result) const {
+    const Node &n1 = nodes[node1];
+    const Node &n2 = nodes[node2];
+    if (!n1.box.intersect(n2.box))
+        return;
+
+    if (n1.isLeaf() && n2.isLeaf()) {
+        for (std::uint32_t i = n1.index; i < n1.index + n1.count; i++)
+            for (std::uint32_t j = n2.index; j < n2.index + n2.count; j++)
+                pushPair(i, j, result);
+    } else if (n1.isLeaf() ||
+               (!n2.isLeaf() && n2.box.perimeter() > n1.box.perimeter())) {
+        parseNodes(node1, node2 + 1, result);
+        parseNodes(node1, n2.index, result);
+    } else {
+        parseNodes(node1 + 1, node2, result);
+        parseNodes(n1.index, node2, result);
+    }
+}
+
+void BVH2d::parseTree(std::vector<std::pair<Item, Item>> &result) const {
+    if (!nodes.empty())
+        parseNode(0, result);
+}
+
+void BVH2d::intersect(const bBox &bbox, std::vector<Item> &result) {
+    if (nodes.empty())
+        return;
+
+    Box box(bbox);
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        std::uint32_t index = stack.back();
+        stack.pop_back();
+        if (!node.box.intersect(box))
+            continue;
+
+        if (node.isLeaf()) {
+            for (std::uint32_t i = node.index; i < node.index + node.count;
+                 i++)
+                if (boxes[i].intersect(box))
+                    result.push_back(items[i]);
+        } else {
+            stack.push_back(node.index);
+            stack.push_back(index + 1);
+        }
+    }
+}
+
+void BVH2d::intersect(const vec2d &point, std::vector<Item> &result) {
+    intersect(bBox(point.x(), point.y(), point.x(), point.y()), result);
+}
+
+// ----------------------
+// broadphase2d
+// ----------------------
+
+void BVH2d::update(const std::list<object2d *> &objects) {
+    buildItems.clear();
+    for (auto object : objects) {
+        const auto &model = object->getCollisionModel_precalc();
+        const auto &bboxes = object->getCollisionModel_bBoxes();
+        for (std::size_t i = 0; i < model.size(); i++)
+            buildItems.push_back({bboxes[i], object, model[i]});
+    }
+    build(buildItems);
+}
+
+void BVH2d::findPairs(std::vector<std::pair<Item, Item>> &result) {
+    parseTree(result);
+}
+
+void BVH2d::precalcDebug_VBO(std::vector<float> &vertices) {
+    for (const auto &node : nodes)
+        pushBBoxVertices(vertices, bBox(node.box.minX, node.box.minY,
+                                        node.box.maxX, node.box.maxY));
+}
+
+std::size_t BVH2d::memoryUsage() const {
+    return nodes.capacity() * sizeof(Node) +
+           (boxes.capacity() + buildBoxes.capacity()) * sizeof(Box) +
+           (items.capacity() + buildItems.capacity()) * sizeof(Item) +
+           centers.capacity() * sizeof(float) +
+           (order.capacity() + stack.capacity()) * sizeof(std::uint32_t);
+}
+
+std::size_t BVH2d::nodeCount() const { return nodes.size(); }
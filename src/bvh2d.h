@@ -0,0 +1,67 @@
+#pragma once
+
+#include "broadphase2d.h"
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy rebuilt on every update. Nodes live in one array
+// in depth first order (the first child follows its parent), boxes are
+// float32 rounded outwards, every item is stored once and split planes are
+// chosen by a binned surface area heuristic.
+class BVH2d : public broadphase2d {
+    static constexpr std::uint32_t leafSizeMax = 4;
+    static constexpr std::size_t binsNumber = 16;
+
+    struct Box {
+        float minX, minY, maxX, maxY;
+
+        Box() = default;
+        Box(const bBox &bbox);
+        Box operator+(const Box &other) const;
+        bool intersect(const Box &other) const;
+        float perimeter() const;
+    };
+
+    struct Node {
+        Box box;
+        std::uint32_t index; // leaf: first item, inner: second child
+        std::uint32_t count; // leaf: items number, inner: 0
+
+        bool isLeaf() const { return count != 0; }
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Box> boxes; // parallel to items
+    std::vector<Item> items;
+    std::vector<std::uint32_t> stack;
+
+    // build only
+    std::vector<Item> buildItems;
+    std::vector<Box> buildBoxes;
+    std::vector<float> centers;
+    std::vector<std::uint32_t> order;
+
+    void build(std::uint32_t node, std::uint32_t begin, std::uint32_t end);
+    void parseNode(std::uint32_t node,
+                   std::vector<std::pair<Item, Item>> &result) const;
+    void parseNodes(std::uint32_t node1, std::uint32_t node2,
+                    std::vector<std::pair<Item, Item>> &result) const;
+    void pushPair(std::uint32_t item1, std::uint32_t item2,
+                  std::vector<std::pair<Item, Item>> &result) const;
+
+  public:
+    BVH2d() = default;
+
+    void build(const std::vector<Item> &newItems);
+    // pairs of different objects, without duplicates
+    void parseTree(std::vector<std::pair<Item, Item>> &result) const;
+    void intersect(const vec2d &point, std::vector<Item> &result);
+
+    void update(const std::list<object2d *> &objects) override;
+    void findPairs(std::vector<std::pair<Item, Item>> &result) override;
+    void intersect(const bBox &bbox, std::vector<Item> &result) override;
+    void precalcDebug_VBO(std::vector<float> &vertices) override;
+    std::size_t memoryUsage() const override;
+
+    std::size_t nodeCount() const;
+};
@@ -0,0 +1,231 @@
+#include "circlebatch2d.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef SIMD2D_X86
+#include <immintrin.h>
+#endif
+
+void circlePairs2d::clear() {
+    x1.clear(), y1.clear(), r1.clear();
+    x2.clear(), y2.clear(), r2.clear();
+}
+
+void circlePairs2d::resize(std::size_t size) {
+    x1.resize(size), y1.resize(size), r1.resize(size);
+    x2.resize(size), y2.resize(size), r2.resize(size);
+}
+
+void circlePairs2d::push(const circle2d &c1, const circle2d &c2) {
+    x1.push_back(c1.getPos().x());
+    y1.push_back(c1.getPos().y());
+    r1.push_back(c1.getRadius());
+    x2.push_back(c2.getPos().x());
+    y2.push_back(c2.getPos().y());
+    r2.push_back(c2.getRadius());
+}
+
+std::size_t circlePairs2d::size() const { return x1.size(); }
+
+namespace {
+
+// the same operations in the same order as the circle2d overload
+std::size_t collisionScalar(const circlePairs2d &pairs, std::size_t begin,
+                            std::size_t count, std::uint32_t *indices,
+                            collisionPrimitivesPoint *points) {
+    for (std::size_t i = begin; i < pairs.size(); i++) {
+        real dx = pairs.x2[i] - pairs.x1[i];
+        real dy = pairs.y2[i] - pairs.y1[i];
+        real distLength2 = dx * dx + dy * dy;
+        real radius = pairs.r2[i] + pairs.r1[i];
+        if (distLength2 > radius * radius)
+            continue;
+
+        real distLength = std::sqrt(distLength2);
+        vec2d normal(dx / distLength, dy / distLength);
+        real share = pairs.r1[i] / radius;
+        indices[count] = i;
+        points[count++] = collisionPrimitivesPoint(
+            vec2d(pairs.x1[i] + dx * share, pairs.y1[i] + dy * share),
+            normal, -normal, radius - distLength);
+    }
+    return count;
+}
+
+#ifdef SIMD2D_X86
+
+// lanes of the mask only, the vector part is already computed
+std::size_t storeContacts(int mask, std::size_t first, const real *px,
+                          const real *py, const real *nx,
+                          const real *ny, const real *depth,
+                          std::size_t count, std::uint32_t *indices,
+                          collisionPrimitivesPoint *points) {
+    for (int lane = 0; mask; lane++, mask >>= 1)
+        if (mask & 1) {
+            vec2d normal(nx[lane], ny[lane]);
+            indices[count] = first + lane;
+            points[count++] = collisionPrimitivesPoint(
+                vec2d(px[lane], py[lane]), normal, -normal, depth[lane]);
+        }
+    return count;
+}
+
+#ifdef PHYSICS2D_FLOAT
+
+__attribute__((target("sse2"))) std::size_t
+collisionSSE2(const circlePairs2d &pairs, std::uint32_t *indices,
+              collisionPrimitivesPoint *points) {
+    std::size_t count = 0, i = 0;
+    alignas(16) float px[4], py[4], nx[4], ny[4], depth[4];
+    for (; i + 4 <= pairs.size(); i += 4) {
+        __m128 x1 = _mm_loadu_ps(&pairs.x1[i]);
+        __m128 y1 = _mm_loadu_ps(&pairs.y1[i]);
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(&pairs.x2[i]), x1);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(&pairs.y2[i]), y1);
+        __m128 distLength2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 r1 = _mm_loadu_ps(&pairs.r1[i]);
+        __m128 radius = _mm_add_ps(_mm_loadu_ps(&pairs.r2[i]), r1);
+        // not greater, so NaN distances hit like in the scalar test
+        int mask = _mm_movemask_ps(
+            _mm_cmpngt_ps(distLength2, _mm_mul_ps(radius, radius)));
+        if (!mask)
+            continue;
+
+        __m128 distLength = _mm_sqrt_ps(distLength2);
+        __m128 share = _mm_div_ps(r1, radius);
+        _mm_store_ps(px, _mm_add_ps(x1, _mm_mul_ps(dx, share)));
+        _mm_store_ps(py, _mm_add_ps(y1, _mm_mul_ps(dy, share)));
+        _mm_store_ps(nx, _mm_div_ps(dx, distLength));
+        _mm_store_ps(ny, _mm_div_ps(dy, distLength));
+        _mm_store_ps(depth, _mm_sub_ps(radius, distLength));
+        count = storeContacts(mask, i, px, py, nx, ny, depth, count, indices,
+                              points);
+    }
+    return collisionScalar(pairs, i, count, indices, points);
+}
+
+__attribute__((target("avx2"))) std::size_t
+collisionAVX2(const circlePairs2d &pairs, std::uint32_t *indices,
+              collisionPrimitivesPoint *points) {
+    std::size_t count = 0, i = 0;
+    alignas(32) float px[8], py[8], nx[8], ny[8], depth[8];
+    for (; i + 8 <= pairs.size(); i += 8) {
+        __m256 x1 = _mm256_loadu_ps(&pairs.x1[i]);
+        __m256 y1 = _mm256_loadu_ps(&pairs.y1[i]);
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&pairs.x2[i]), x1);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&pairs.y2[i]), y1);
+        __m256 distLength2 =
+            _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        __m256 r1 = _mm256_loadu_ps(&pairs.r1[i]);
+        __m256 radius = _mm256_add_ps(_mm256_loadu_ps(&pairs.r2[i]), r1);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(
+            distLength2, _mm256_mul_ps(radius, radius), _CMP_NGT_UQ));
+        if (!mask)
+            continue;
+
+        __m256 distLength = _mm256_sqrt_ps(distLength2);
+        __m256 share = _mm256_div_ps(r1, radius);
+        _mm256_store_ps(px, _mm256_add_ps(x1, _mm256_mul_ps(dx, share)));
+        _mm256_store_ps(py, _mm256_add_ps(y1, _mm256_mul_ps(dy, share)));
+        _mm256_store_ps(nx, _mm256_div_ps(dx, distLength));
+        _mm256_store_ps(ny, _mm256_div_ps(dy, distLength));
+        _mm256_store_ps(depth, _mm256_sub_ps(radius, distLength));
+        count = storeContacts(mask, i, px, py, nx, ny, depth, count, indices,
+                              points);
+    }
+    return collisionScalar(pairs, i, count, indices, points);
+}
+
+#else
+
+__attribute__((target("sse2"))) std::size_t
+collisionSSE2(const circlePairs2d &pairs, std::uint32_t *indices,
+              collisionPrimitivesPoint *points) {
+    std::size_t count = 0, i = 0;
+    alignas(16) double px[2], py[2], nx[2], ny[2], depth[2];
+    for (; i + 2 <= pairs.size(); i += 2) {
+        __m128d x1 = _mm_loadu_pd(&pairs.x1[i]);
+        __m128d y1 = _mm_loadu_pd(&pairs.y1[i]);
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(&pairs.x2[i]), x1);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(&pairs.y2[i]), y1);
+        __m128d distLength2 =
+            _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+        __m128d r1 = _mm_loadu_pd(&pairs.r1[i]);
+        __m128d radius = _mm_add_pd(_mm_loadu_pd(&pairs.r2[i]), r1);
+        // not greater, so NaN distances hit like in the scalar test
+        int mask = _mm_movemask_pd(
+            _mm_cmpngt_pd(distLength2, _mm_mul_pd(radius, radius)));
+        if (!mask)
+            continue;
+
+        __m128d distLength = _mm_sqrt_pd(distLength2);
+        __m128d share = _mm_div_pd(r1, radius);
+        _mm_store_pd(px, _mm_add_pd(x1, _mm_mul_pd(dx, share)));
+        _mm_store_pd(py, _mm_add_pd(y1, _mm_mul_pd(dy, share)));
+        _mm_store_pd(nx, _mm_div_pd(dx, distLength));
+        _mm_store_pd(ny, _mm_div_pd(dy, distLength));
+        _mm_store_pd(depth, _mm_sub_pd(radius, distLength));
+        count = storeContacts(mask, i, px, py, nx, ny, depth, count, indices,
+                              points);
+    }
+    return collisionScalar(pairs, i, count, indices, points);
+}
+
+__attribute__((target("avx2"))) std::size_t
+collisionAVX2(const circlePairs2d &pairs, std::uint32_t *indices,
+              collisionPrimitivesPoint *points) {
+    std::size_t count = 0, i = 0;
+    alignas(32) double px[4], py[4], nx[4], ny[4], depth[4];
+    for (; i + 4 <= pairs.size(); i += 4) {
+        __m256d x1 = _mm256_loadu_pd(&pairs.x1[i]);
+        __m256d y1 = _mm256_loadu_pd(&pairs.y1[i]);
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(&pairs.x2[i]), x1);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(&pairs.y2[i]), y1);
+        __m256d distLength2 =
+            _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        __m256d r1 = _mm256_loadu_pd(&pairs.r1[i]);
+        __m256d radius = _mm256_add_pd(_mm256_loadu_pd(&pairs.r2[i]), r1);
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(
+            distLength2, _mm256_mul_pd(radius, radius), _CMP_NGT_UQ));
+        if (!mask)
+            continue;
+
+        __m256d distLength = _mm256_sqrt_pd(distLength2);
+        __m256d share = _mm256_div_pd(r1, radius);
+        _mm256_store_pd(px, _mm256_add_pd(x1, _mm256_mul_pd(dx, share)));
+        _mm256_store_pd(py, _mm256_add_pd(y1, _mm256_mul_pd(dy, share)));
+        _mm256_store_pd(nx, _mm256_div_pd(dx, distLength));
+        _mm256_store_pd(ny, _mm256_div_pd(dy, distLength));
+        _mm256_store_pd(depth, _mm256_sub_pd(radius, distLength));
+        count = storeContacts(mask, i, px, py, nx, ny, depth, count, indices,
+                              points);
+    }
+    return collisionScalar(pairs, i, count, indices, points);
+}
+
+#endif // PHYSICS2D_FLOAT
+
+#endif
+
+} // namespace
+
+std::size_t collisionCircles(const circlePairs2d &pairs,
+                             std::uint32_t *indices,
+                             collisionPrimitivesPoint *points) {
+    return collisionCircles(pairs, indices, points, simdLevel());
+}
+
+// a level above simdLevel() falls back to the best supported one
+std::size_t collisionCircles(const circlePairs2d &pairs,
+                             std::uint32_t *indices,
+                             collisionPrimitivesPoint *points,
+                             SimdLevel level) {
+    level = std::min(level, simdLevel());
+#ifdef SIMD2D_X86
+    if (level == SimdLevel::AVX2)
+        return collisionAVX2(pairs, indices, points);
+    if (level == SimdLevel::SSE2)
+        return collisionSSE2(pairs, indices, points);
+#endif
+    return collisionScalar(pairs, 0, 0, indices, points);
+}
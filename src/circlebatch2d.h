@@ -0,0 +1,34 @@
+#pragma once
+
+#include "primitive2d.h"
+#include "simd2d.h"
+#include <cstdint>
+#include <vector>
+
+// Circle/circle narrowphase over a structure of arrays, several pairs per
+// instruction, twice as many in PHYSICS2D_FLOAT builds. Results are bit
+// identical to the collisionPrimitives overload on every level. Not on the
+// world path: gathering the pairs from primitive pointers into the arrays and
+// scattering the contacts back costs more than the kernel saves, see
+// bench_narrowphase. It pays off for callers that keep circles in the arrays.
+
+struct circlePairs2d {
+    std::vector<real> x1, y1, r1;
+    std::vector<real> x2, y2, r2;
+
+    void clear();
+    void resize(std::size_t size);
+    void push(const circle2d &c1, const circle2d &c2);
+    std::size_t size() const;
+};
+
+// Only the hitting pairs are written, in input order: points[k] is the
+// contact of pair indices[k]. Both buffers hold pairs.size() entries,
+// returns the number of hits.
+std::size_t collisionCircles(const circlePairs2d &pairs,
+                             std::uint32_t *indices,
+                             collisionPrimitivesPoint *points);
+std::size_t collisionCircles(const circlePairs2d &pairs,
+                             std::uint32_t *indices,
+                             collisionPrimitivesPoint *points,
+                             SimdLevel level);
@@ -0,0 +1,80 @@
+#include "commandqueue2d.h"
+#include <bit>
+#include <utility>
+
+commandQueue2d::~commandQueue2d() {
+    drain([](const Command &) {});
+    for (auto &block : nodeBlocks)
+        delete[] block.load();
+}
+
+commandQueue2d::Node &commandQueue2d::node(std::uint32_t index) {
+    std::size_t block = std::bit_width(index / blockSize);
+    std::size_t first = block ? blockSize << (block - 1) : 0;
+    Node *nodes = nodeBlocks[block].load(std::memory_order_acquire);
+    if (!nodes) {
+        // the first producer to get here allocates the block
+        std::size_t size = block ? first : blockSize;
+        Node *fresh = new Node[size];
+        for (std::size_t i = 0; i < size; i++)
+            fresh[i].index = first + i;
+        if (nodeBlocks[block].compare_exchange_strong(
+                nodes, fresh, std::memory_order_acq_rel))
+            nodes = fresh;
+        else
+            delete[] fresh;
+    }
+    return nodes[index - first];
+}
+
+commandQueue2d::Node *commandQueue2d::allocate(Command &&command) {
+    std::uint64_t free = freeHead.load(std::memory_order_acquire);
+    while (std::uint32_t(free) != none) {
+        Node &reused = node(std::uint32_t(free));
+        std::uint64_t next =
+            ((free >> 32) + 1) << 32 |
+            reused.nextFree.load(std::memory_order_relaxed);
+        if (freeHead.compare_exchange_weak(free, next,
+                                           std::memory_order_acquire)) {
+            reused.command = std::move(command);
+            return &reused;
+        }
+    }
+
+    Node &fresh = node(nodeCount.fetch_add(1, std::memory_order_relaxed));
+    fresh.command = std::move(command);
+    return &fresh;
+}
+
+void commandQueue2d::recycle(Node *node) {
+    node->command = {}; // drops what a callback holds
+    std::uint64_t free = freeHead.load(std::memory_order_relaxed);
+    do
+        node->nextFree.store(std::uint32_t(free), std::memory_order_relaxed);
+    while (!freeHead.compare_exchange_weak(
+        free, ((free >> 32) + 1) << 32 | node->index,
+        std::memory_order_release, std::memory_order_relaxed));
+}
+
+void commandQueue2d::push(Command command) {
+    Node *node = allocate(std::move(command));
+    node->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(node->next, node,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed))
+        ;
+}
+
+// the consumer takes the list whole, so a node is never popped while a
+// producer holds it
+commandQueue2d::Node *commandQueue2d::take() {
+    Node *node = head.exchange(nullptr, std::memory_order_acquire);
+    Node *reversed = nullptr;
+    while (node) {
+        Node *next = node->next;
+        node->next = reversed;
+        reversed = node;
+        node = next;
+    }
+    return reversed;
+}
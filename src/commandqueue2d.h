@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+class object2d;
+class connection2d;
+
+// Lock free queue of world2d changes, many producer threads and one
+// consumer. Producers push onto a list head, the consumer takes the whole
+// list at once and reverses it into the push order. Drained nodes are kept
+// for later pushes, a push allocates only when more commands are in flight
+// than ever before.
+class commandQueue2d {
+  public:
+    enum class Type {
+        AddObject,
+        DeleteObject,
+        AddConnection,
+        DeleteConnection,
+        Run // only applied
+    };
+    struct Command {
+        Type type;
+        object2d *object = nullptr;
+        connection2d *connection = nullptr;
+        std::function<void()> applied; // run by the consumer, may be empty
+    };
+
+  private:
+    static constexpr std::uint32_t none = -1;
+    struct Node {
+        Command command;
+        Node *next = nullptr;
+        std::atomic<std::uint32_t> nextFree{none};
+        std::uint32_t index = 0;
+    };
+    std::atomic<Node *> head{nullptr};
+
+    // nodes by index in blocks of 64, 64, 128, 256 ... kept until the queue
+    // goes, index i is in block std::bit_width(i / 64)
+    static constexpr std::size_t blockSize = 64, blocks = 27;
+    std::atomic<Node *> nodeBlocks[blocks] = {};
+    std::atomic<std::uint32_t> nodeCount{0};
+    // drained nodes, generation << 32 | index of the first one. Every change
+    // bumps the generation, so a pop that read a node's nextFree before
+    // other threads popped and pushed it back fails its CAS.
+    std::atomic<std::uint64_t> freeHead{none};
+
+    Node &node(std::uint32_t index);
+    Node *take(); // every pushed node, oldest first
+    Node *allocate(Command &&command);
+    void recycle(Node *node); // consumer only
+
+  public:
+    commandQueue2d() = default;
+    commandQueue2d(const commandQueue2d &) = delete;
+    commandQueue2d &operator=(const commandQueue2d &) = delete;
+    ~commandQueue2d(); // drops the commands left
+
+    void push(Command command); // any thread
+
+    // consumer only, fn(command) for every command pushed before, in order
+    template <typename F> void drain(F &&fn) {
+        for (Node *node = take(); node;) {
+            fn(node->command);
+            Node *next = node->next;
+            recycle(node);
+            node = next;
+        }
+    }
+};
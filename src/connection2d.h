@@ -34,6 +34,22 @@ class connection2d {
         vec2d worldPoint1 = getWorldPoint1();
         vec2d worldPoint2 = getWorldPoint2();
 
+        vertices.push_back(worldPoint1.x());
+        vertices.push_back(worldPoint1.y());
+        vertices.push_back(worldPoint2.x());
+        vertices.push_back(worldPoint2.y());
+    }
+    // with the objects alpha between their previous and current transforms
+    void precalcDebug_VBO(std::vector<float> &vertices, real alpha) {
+        vec2d worldPoint1 =
+            getObject1()
+                ? getPoint1() * getObject1()->getInterpolatedMatrix(alpha)
+                : getPoint1();
+        vec2d worldPoint2 =
+            getObject2()
+                ? getPoint2() * getObject2()->getInterpolatedMatrix(alpha)
+                : getPoint2();
+
         vertices.push_back(worldPoint1.x());
         vertices.push_back(worldPoint1.y());
         vertices.push_back(worldPoint2.x());
@@ -13,7 +13,9 @@ GLWidget::GLWidget(QWidget *widget){};
 
 GLWidget::~GLWidget() {
     makeCurrent();
+    world.stop();
     world.destroy();
+    renderer.destroy();
     delete program;
     delete program_debug;
     doneCurrent();
@@ -44,16 +46,16 @@ void GLWidget::initializeGL() {
     std::uniform_real_distribution<> dis(0.0, 1.0);
     float coef = float(width()) / height();
     for (int i = 0; i < 5; i++) {
-        double pos_x = (dis(gen) * 60 - 30) * coef;
-        double pos_y = dis(gen) * 60 - 30;
-        double angle = dis(gen) * 2 * pi;
+        real pos_x = (dis(gen) * 60 - 30) * coef;
+        real pos_y = dis(gen) * 60 - 30;
+        real angle = dis(gen) * 2 * pi;
 
-        double speedX = dis(gen) * 0.1 - 0.05;
-        double speedY = dis(gen) * 0.1 - 0.05;
-        double speedAngle = dis(gen) * 0.001 - 0.0005;
+        real speedX = dis(gen) * 0.1 - 0.05;
+        real speedY = dis(gen) * 0.1 - 0.05;
+        real speedAngle = dis(gen) * 0.001 - 0.0005;
 
-        double width = 5 + dis(gen) * 20;
-        double height = 5 + dis(gen) * 20;
+        real width = 5 + dis(gen) * 20;
+        real height = 5 + dis(gen) * 20;
         int grid_size_x = width * 0.5;
         int grid_size_y = height * 0.5;
 
@@ -84,7 +86,7 @@ void GLWidget::initializeGL() {
     for (int i = 0; i < 4; i++) {
         object = new object2d();
         object->add(new rectangle2d({0, 0}, {5, 90}, pi / 2 * i));
-        object->setPos({50 * std::cos(pi / 2 * i), 50 * std::sin(pi / 2 * i)});
+        object->setPos(vec2d(pi / 2 * i) * 50);
         object->setIsFixed(true);
         world.addObject(object);
     }
@@ -110,8 +112,8 @@ void GLWidget::initializeGL() {
                                          PROGRAM_DEBUG_VERTEX_ATTRIBUTE);
     program_debug->link();
 
-    elapsedTimer = new QElapsedTimer();
-    elapsedTimer->start();
+    // debug geometry in every snapshot
+    world.start(true);
 
     timer = new QTimer(this);
     connect(timer, &QTimer::timeout, [this]() { update(); });
@@ -147,13 +149,11 @@ void GLWidget::paintGL() {
 
     updateMatrix();
 
-    world.update(1000.0 / std::max(elapsedTimer->elapsed(), (long long)100));
-    elapsedTimer->restart();
-
+    // the world steps on its own thread, a slow step does not hold the frame
     bool isDebug = true;
-    world.precalc(isDebug);
-    world.collisionDetection();
-    world.collisionResolve();
+    const snapshot2d &snapshot = world.getSnapshot();
+    // up to a tick behind the last step, moved on by the wall clock
+    real alpha = snapshot.getInterpolation(snapshot2d::clock::now());
     // for (auto object : world) {
     //     QMatrix4x4 model_matrix = matrix;
     //     model_matrix.translate(object->getPos().x(), object->getPos().y());
@@ -162,19 +162,20 @@ void GLWidget::paintGL() {
 
     // Draw frame only for debug
     if (isDebug) {
+        renderer.precalcDebug_VBO(snapshot, alpha);
         program_debug->bind();
 
         for (size_t i = 0; i < debug_VBO_number; i++) {
-            world.getDebug_VBO(i)->bind();
+            renderer.getDebug_VBO(i)->bind();
             program_debug->setUniformValue("externalColor",
-                                           world.getDebug_color(i));
+                                           renderer.getDebug_color(i));
             program_debug->setUniformValue("matrix", world_matrix);
             program_debug->enableAttributeArray(PROGRAM_DEBUG_VERTEX_ATTRIBUTE);
             program_debug->setAttributeBuffer(PROGRAM_DEBUG_VERTEX_ATTRIBUTE,
                                               GL_FLOAT, 0, 2,
                                               2 * sizeof(GLfloat));
-            glDrawArrays(GL_LINES, 0, world.getDebug_VBO(i)->size());
-            world.getDebug_VBO(i)->release();
+            glDrawArrays(GL_LINES, 0, renderer.getDebug_vertexCount(i));
+            renderer.getDebug_VBO(i)->release();
         }
         program_debug->release();
     }
@@ -197,6 +198,8 @@ void GLWidget::mousePressEvent(QMouseEvent *event) {
         vec2d worldPos =
             world.getCamera().cameraToWorld(widgetToCamera(event->pos()));
 
+        // the query and the object transform are the stepping thread's
+        std::lock_guard lock(world.getStepMutex());
         std::vector<Item> result;
         world.intersect(circle2d(worldPos, 0.5), result);
         for (auto item : result)
@@ -205,7 +208,7 @@ void GLWidget::mousePressEvent(QMouseEvent *event) {
 
                 mouse_connection =
                     new connection2d(item.object, nullptr, localPos, worldPos);
-                world.addConnection(mouse_connection);
+                world.postAddConnection(mouse_connection);
 
                 grabbedLM = true;
                 break;
@@ -218,18 +221,23 @@ void GLWidget::mousePressEvent(QMouseEvent *event) {
 void GLWidget::mouseMoveEvent(QMouseEvent *event) {
     vec2d worldPos =
         world.getCamera().cameraToWorld(widgetToCamera(event->pos()));
+    // the connection and the objects belong to the stepping thread, the
+    // release posts its delete after these
     if (grabbedLM)
-        mouse_connection->setPoint2(worldPos);
-    if (grabbedRM) {
-        std::vector<Item> result;
-        world.intersect(circle2d(worldPos, 5), result);
-        for (auto item : result)
-            if (!item.object->getIsFixed()) {
-                vec2d localPos = item.object->worldToObject(worldPos);
-                item.object->explosion(localPos);
-                break;
-            }
-    }
+        world.post([connection = mouse_connection, worldPos]() {
+            connection->setPoint2(worldPos);
+        });
+    if (grabbedRM)
+        world.post([this, worldPos]() {
+            std::vector<Item> result;
+            world.intersect(circle2d(worldPos, 5), result);
+            for (auto item : result)
+                if (!item.object->getIsFixed()) {
+                    vec2d localPos = item.object->worldToObject(worldPos);
+                    item.object->explosion(localPos);
+                    break;
+                }
+        });
 
     // GLWidget::mouseMoveEvent(event);
 }
@@ -240,7 +248,9 @@ void GLWidget::mouseReleaseEvent(QMouseEvent *event) {
 
     if (grabbedLM) {
         grabbedLM = false;
-        world.deleteConnection(mouse_connection);
+        world.postDeleteConnection(
+            mouse_connection,
+            [connection = mouse_connection]() { delete connection; });
     }
 
     // GLWidget::mouseReleaseEvent(event);
@@ -1,8 +1,8 @@
 #pragma once
 
 #include "mesh2d.h"
+#include "renderer2d.h"
 #include "world2d.h"
-#include <QElapsedTimer>
 #include <QMatrix4x4>
 #include <QOpenGLBuffer>
 #include <QOpenGLFunctions>
@@ -35,13 +35,13 @@ class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions {
 
   private:
     world2d world;
+    renderer2d renderer;
     QMatrix4x4 world_matrix;
     QOpenGLShaderProgram *program = nullptr, *program_debug = nullptr;
     bool grabbedRM = false;
     bool grabbedLM = false;
     connection2d *mouse_connection;
     QTimer *timer;
-    QElapsedTimer *elapsedTimer;
     static constexpr int PROGRAM_VERTEX_ATTRIBUTE = 0;
     static constexpr int PROGRAM_TEXCOORD_ATTRIBUTE = 1;
     static constexpr int PROGRAM_DEBUG_VERTEX_ATTRIBUTE = 2;
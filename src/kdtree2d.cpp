@@ -1,17 +1,19 @@
 #include "kdtree2d.h"
-#include <QDebug>
+#include <algorithm>
+#include <bit>
 
 enum class SplitType { Leaf1, Leaf2 };
 bBox splitLeaf(const bBox &bbox, std::size_t depth, SplitType type) {
+    // the same middle for both leaves, so they share the boundary exactly
     if (type == SplitType::Leaf1) {
         if (depth % 2 == 0)
             // vertical
             return bBox(bbox.getMinX(), bbox.getMinY(),
-                        bbox.getMaxX() - bbox.width() / 2, bbox.getMaxY());
+                        bbox.getMinX() + bbox.width() / 2, bbox.getMaxY());
         else
             // horizontal
             return bBox(bbox.getMinX(), bbox.getMinY(), bbox.getMaxX(),
-                        bbox.getMaxY() - bbox.height() / 2);
+                        bbox.getMinY() + bbox.height() / 2);
     } else {
         if (depth % 2 == 0)
             // vertical
@@ -26,8 +28,10 @@ bBox splitLeaf(const bBox &bbox, std::size_t depth, SplitType type) {
 
 KDTree2d::KDTree2d(const bBox &bbox) : bbox(bbox) {}
 KDTree2d::~KDTree2d() {
-    delete leaf1;
-    delete leaf2;
+    if (!arenaLeaves) {
+        delete leaf1;
+        delete leaf2;
+    }
 }
 
 void KDTree2d::addItem(const Item &item, std::size_t depth) {
@@ -53,6 +57,94 @@ void KDTree2d::addItem(const Item &item, std::size_t depth) {
     }
 }
 
+// addItem keeps the items of one object in a leaf until an item of another
+// object comes at k. Then item k and the ones before go down in reverse
+// order, every later item goes straight down. False if this stays a leaf.
+bool KDTree2d::split(const std::vector<Item> &items, std::size_t depth,
+                     std::deque<KDTree2d> &arena, std::vector<Item> &items1,
+                     std::vector<Item> &items2) {
+    std::size_t k = 1;
+    while (k < items.size() && items[k].object == items[k - 1].object)
+        k++;
+    if (k >= items.size() || depth >= depthMax) {
+        list = items;
+        return false;
+    }
+
+    leaf1 = &arena.emplace_back(splitLeaf(bbox, depth, SplitType::Leaf1));
+    leaf2 = &arena.emplace_back(splitLeaf(bbox, depth, SplitType::Leaf2));
+    arenaLeaves = true;
+    auto push = [&](const Item &item) {
+        if (item.bbox.intersect(leaf1->bbox))
+            items1.push_back(item);
+        if (item.bbox.intersect(leaf2->bbox))
+            items2.push_back(item);
+    };
+    for (std::size_t i = k + 1; i-- > 0;)
+        push(items[i]);
+    for (std::size_t i = k + 1; i < items.size(); i++)
+        push(items[i]);
+    return true;
+}
+
+void KDTree2d::build(const std::vector<Item> &items, std::size_t depth,
+                     std::deque<KDTree2d> &arena) {
+    std::vector<Item> items1, items2;
+    if (split(items, depth, arena, items1, items2)) {
+        leaf1->build(items1, depth + 1, arena);
+        leaf2->build(items2, depth + 1, arena);
+    }
+}
+
+// the top levels are split here until there is work for every thread
+void KDTree2d::build(const std::vector<Item> &items, threadPool2d *pool,
+                     std::vector<std::deque<KDTree2d>> &arenas) {
+    arenas.assign(1, {});
+    if (!pool || pool->getThreads() == 1 || items.size() < taskItemsMin) {
+        build(items, 0, arenas[0]);
+        return;
+    }
+
+    struct Task {
+        KDTree2d *node;
+        std::size_t depth;
+        std::vector<Item> items;
+    };
+    std::vector<Task> tasks, next;
+    std::vector<Item> items1, items2;
+    if (!split(items, 0, arenas[0], items1, items2))
+        return;
+    tasks = {{leaf1, 1, std::move(items1)}, {leaf2, 1, std::move(items2)}};
+
+    std::size_t tasksMin = pool->getThreads() * 4;
+    for (bool splitted = true; splitted && tasks.size() < tasksMin;) {
+        splitted = false;
+        next.clear();
+        for (auto &task : tasks) {
+            if (task.items.size() < taskItemsMin) {
+                next.push_back(std::move(task));
+                continue;
+            }
+            items1.clear();
+            items2.clear();
+            if (task.node->split(task.items, task.depth, arenas[0], items1,
+                                 items2)) {
+                next.push_back(
+                    {task.node->leaf1, task.depth + 1, std::move(items1)});
+                next.push_back(
+                    {task.node->leaf2, task.depth + 1, std::move(items2)});
+                splitted = true;
+            }
+        }
+        tasks.swap(next);
+    }
+
+    arenas.resize(tasks.size() + 1);
+    pool->run(tasks.size(), [&tasks, &arenas](std::size_t i) {
+        tasks[i].node->build(tasks[i].items, tasks[i].depth, arenas[i + 1]);
+    });
+}
+
 void KDTree2d::precalcDebug_VBO(std::vector<float> &vertices) {
     pushBBoxVertices(vertices, bbox);
     if (leaf1)
@@ -61,28 +153,94 @@ void KDTree2d::precalcDebug_VBO(std::vector<float> &vertices) {
         leaf2->precalcDebug_VBO(vertices);
 }
 
+// leaves split the root half open, the max sides of the root belong to the
+// leaves touching them
+bool KDTree2d::owns(real x, real y, const bBox &root) const {
+    return x >= bbox.getMinX() &&
+           (x < bbox.getMaxX() || bbox.getMaxX() >= root.getMaxX()) &&
+           y >= bbox.getMinY() &&
+           (y < bbox.getMaxY() || bbox.getMaxY() >= root.getMaxY());
+}
+
 void KDTree2d::parseTree(std::vector<std::pair<Item, Item>> &result) {
+    parseTree(result, bbox);
+}
+
+// an item is in every leaf it touches, a pair is reported only by the leaf
+// owning the min corner of the boxes intersection
+void KDTree2d::parseTree(std::vector<std::pair<Item, Item>> &result,
+                         const bBox &root) {
     for (std::size_t i = 0; i < list.size(); i++)
-        for (std::size_t j = i + 1; j < list.size(); j++)
-            if (list[i].object < list[j].object)
-                result.push_back({list[i], list[j]});
-            else if (list[i].object > list[j].object)
-                result.push_back({list[j], list[i]});
+        for (std::size_t j = i + 1; j < list.size(); j++) {
+            const Item &item1 = list[i];
+            const Item &item2 = list[j];
+            if (item1.object == item2.object ||
+                !item1.bbox.intersect(item2.bbox) ||
+                !owns(std::max(item1.bbox.getMinX(), item2.bbox.getMinX()),
+                      std::max(item1.bbox.getMinY(), item2.bbox.getMinY()),
+                      root))
+                continue;
+
+            if (item1.object < item2.object)
+                result.push_back({item1, item2});
+            else
+                result.push_back({item2, item1});
+        }
 
     if (leaf1)
-        leaf1->parseTree(result);
+        leaf1->parseTree(result, root);
     if (leaf2)
-        leaf2->parseTree(result);
+        leaf2->parseTree(result, root);
+}
+
+// nodes with leaves keep no items, the pairs are all in the subtrees
+void KDTree2d::subtrees(std::size_t depth, std::size_t depthTask,
+                        std::vector<KDTree2d *> &result) {
+    if (depth == depthTask || !leaf1) {
+        result.push_back(this);
+        return;
+    }
+    leaf1->subtrees(depth + 1, depthTask, result);
+    leaf2->subtrees(depth + 1, depthTask, result);
+}
+
+// subtrees in the order the serial walk meets them, so the joined buffers
+// keep its pair order
+void KDTree2d::parseTree(
+    std::vector<std::pair<Item, Item>> &result, threadPool2d *pool,
+    std::vector<std::vector<std::pair<Item, Item>>> &buffers) {
+    if (!pool || pool->getThreads() == 1) {
+        parseTree(result);
+        return;
+    }
+
+    std::vector<KDTree2d *> tasks;
+    subtrees(0, std::bit_width(pool->getThreads() * 8 - 1), tasks);
+    buffers.resize(tasks.size());
+    pool->run(tasks.size(), [this, &tasks, &buffers](std::size_t i) {
+        buffers[i].clear();
+        tasks[i]->parseTree(buffers[i], bbox);
+    });
+    for (const auto &buffer : buffers)
+        result.insert(end(result), begin(buffer), end(buffer));
 }
 
 void KDTree2d::intersect(const bBox &bbox, std::vector<Item> &result) {
+    intersect(bbox, result, this->bbox);
+}
+
+void KDTree2d::intersect(const bBox &bbox, std::vector<Item> &result,
+                         const bBox &root) {
     for (const auto &item : list)
-        result.push_back(item);
+        if (item.bbox.intersect(bbox) &&
+            owns(std::max(item.bbox.getMinX(), bbox.getMinX()),
+                 std::max(item.bbox.getMinY(), bbox.getMinY()), root))
+            result.push_back(item);
 
     if (leaf1 && leaf1->bbox.intersect(bbox))
-        leaf1->intersect(bbox, result);
+        leaf1->intersect(bbox, result, root);
     if (leaf2 && leaf2->bbox.intersect(bbox))
-        leaf2->intersect(bbox, result);
+        leaf2->intersect(bbox, result, root);
 }
 
 void KDTree2d::intersect(const vec2d &point, std::vector<Item> &result) {
@@ -94,3 +252,19 @@ void KDTree2d::intersect(const vec2d &point, std::vector<Item> &result) {
     if (leaf2 && leaf2->bbox.intersect(point))
         leaf2->intersect(point, result);
 }
+
+std::size_t KDTree2d::nodeCount() const {
+    return 1 + (leaf1 ? leaf1->nodeCount() : 0) +
+           (leaf2 ? leaf2->nodeCount() : 0);
+}
+
+std::size_t KDTree2d::itemCount() const {
+    return list.size() + (leaf1 ? leaf1->itemCount() : 0) +
+           (leaf2 ? leaf2->itemCount() : 0);
+}
+
+std::size_t KDTree2d::memoryUsage() const {
+    return sizeof(KDTree2d) + list.capacity() * sizeof(Item) +
+           (leaf1 ? leaf1->memoryUsage() : 0) +
+           (leaf2 ? leaf2->memoryUsage() : 0);
+}
\ No newline at end of file
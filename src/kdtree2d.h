@@ -1,32 +1,61 @@
 #pragma once
 
+#include "broadphase2d.h"
 #include "math2d.h"
 #include "object2d.h"
 #include "primitive2d.h"
+#include "threadpool2d.h"
+#include <deque>
 #include <list>
 
-struct Item {
-    bBox bbox;
-    object2d *object;
-    primitive2d *primitive;
-};
-
 class KDTree2d {
     static constexpr std::size_t depthMax = 15;
+    // smaller subtrees are built by the thread splitting them
+    static constexpr std::size_t taskItemsMin = 512;
 
     bBox bbox;
     std::vector<Item> list;
 
     KDTree2d *leaf1 = nullptr;
     KDTree2d *leaf2 = nullptr;
+    bool arenaLeaves = false; // leaves of build, freed with their arena
+
+    bool owns(real x, real y, const bBox &root) const;
+    bool split(const std::vector<Item> &items, std::size_t depth,
+               std::deque<KDTree2d> &arena, std::vector<Item> &items1,
+               std::vector<Item> &items2);
+    void build(const std::vector<Item> &items, std::size_t depth,
+               std::deque<KDTree2d> &arena);
+    void subtrees(std::size_t depth, std::size_t depthTask,
+                  std::vector<KDTree2d *> &result);
+    void parseTree(std::vector<std::pair<Item, Item>> &result,
+                   const bBox &root);
+    void intersect(const bBox &bbox, std::vector<Item> &result,
+                   const bBox &root);
 
   public:
     KDTree2d(const bBox &bbox);
     ~KDTree2d();
 
     void addItem(const Item &item, std::size_t depth = 0);
+    // the tree of addItem on every item in order, on an empty tree. Big
+    // subtrees are built by the threads of pool with a node arena each, the
+    // arenas must outlive the tree.
+    void build(const std::vector<Item> &items, threadPool2d *pool,
+               std::vector<std::deque<KDTree2d>> &arenas);
     void precalcDebug_VBO(std::vector<float> &vertices);
+    // every overlapping pair of different objects once
     void parseTree(std::vector<std::pair<Item, Item>> &result);
+    // the same pairs in the same order, subtrees are parsed by the threads
+    // of pool into buffers of their own
+    void parseTree(std::vector<std::pair<Item, Item>> &result,
+                   threadPool2d *pool,
+                   std::vector<std::vector<std::pair<Item, Item>>> &buffers);
+    // every item overlapping bbox once
     void intersect(const bBox &bbox, std::vector<Item> &result);
     void intersect(const vec2d &point, std::vector<Item> &result);
+
+    std::size_t nodeCount() const;
+    std::size_t itemCount() const;   // with duplicates
+    std::size_t memoryUsage() const; // bytes
 };
\ No newline at end of file
@@ -1,107 +1,268 @@
 #pragma once
 
-#include <QPointF>
-#include <QTransform>
+#include "simd2d.h"
+#include <cmath>
+#include <cstddef>
+
+// Header only, so every operation inlines into the hot loops. Everything
+// that needs no <cmath> call is constexpr.
+
+// scalar of the physics pipeline, PHYSICS2D_FLOAT builds it in single
+// precision. math2d itself is built for both.
+#ifdef PHYSICS2D_FLOAT
+using real = float;
+#else
+using real = double;
+#endif
 
 constexpr double pi = 3.14159265358979323846;
-double toRadians(double degrees);
-double toDegrees(double radians);
+constexpr double toRadians(double degrees) noexcept {
+    return degrees / 360 * 2 * pi;
+}
+constexpr double toDegrees(double radians) noexcept {
+    return radians / (2 * pi) * 360;
+}
 
-class mat23;
+template <typename T> class basicMat23;
 
-class vec2d {
-    double ix, iy;
+template <typename T> class basicVec2d {
+    T ix, iy;
 
   public:
-    vec2d();
-    vec2d(const vec2d &v) = default;
-    vec2d &operator=(const vec2d &v) = default;
-    vec2d(vec2d &&v) noexcept = default;
-    vec2d &operator=(vec2d &&v) noexcept = default;
-    ~vec2d() = default;
-
-    vec2d(double x, double y);
-    vec2d(double angle); // normalized vector
-
-    vec2d(const QPointF &p);
-    vec2d &operator=(const QPointF &p);
-    operator QPointF() const;
-
-    double x() const;
-    void setX(double newX);
-    double y() const;
-    void setY(double newY);
-
-    vec2d &rotate(double angle);
-    vec2d rotated(double angle) const;
-    vec2d &translate(double x, double y);
-    vec2d translated(double x, double y) const;
-    vec2d &norm();
-    vec2d normed() const;
-    vec2d &perp(); //+90 degrees
-    vec2d perped() const;
-    double dotProduct(const vec2d &v) const;
-    double det(const vec2d &v) const;
-    double angle(const vec2d &v) const;
-    double length() const;
-    double length2() const;
-    double manhattanLength() const;
-
-    vec2d operator+(const vec2d &v) const;
-    vec2d &operator+=(const vec2d &v);
-    vec2d operator-(const vec2d &v) const;
-    vec2d &operator-=(const vec2d &v);
-    vec2d operator-() const;
-    vec2d operator*(double scale) const;
-    vec2d &operator*=(double scale);
-    vec2d operator*(const mat23 &m) const;
-    vec2d &operator*=(const mat23 &m);
-    double operator*(const vec2d &v) const;
-    vec2d operator/(double divisor) const;
-    vec2d &operator/=(double divisor);
-
-    friend mat23;
+    constexpr basicVec2d() noexcept : ix(0), iy(0) {}
+    constexpr basicVec2d(const basicVec2d &v) noexcept = default;
+    constexpr basicVec2d &operator=(const basicVec2d &v) noexcept = default;
+    constexpr basicVec2d(basicVec2d &&v) noexcept = default;
+    constexpr basicVec2d &operator=(basicVec2d &&v) noexcept = default;
+    ~basicVec2d() = default;
+
+    constexpr basicVec2d(T x, T y) noexcept : ix(x), iy(y) {}
+    // normalized vector
+    basicVec2d(T angle) noexcept : ix(std::cos(angle)), iy(std::sin(angle)) {}
+
+    constexpr T x() const noexcept { return ix; }
+    constexpr void setX(T newX) noexcept { ix = newX; }
+    constexpr T y() const noexcept { return iy; }
+    constexpr void setY(T newY) noexcept { iy = newY; }
+
+    basicVec2d &rotate(T angle) noexcept {
+        return rotate(std::sin(angle), std::cos(angle));
+    }
+    basicVec2d rotated(T angle) const noexcept {
+        return rotated(std::sin(angle), std::cos(angle));
+    }
+    // sine and cosine of the angle, to share them between several vectors
+    constexpr basicVec2d &rotate(T sa, T ca) noexcept {
+        *this = rotated(sa, ca);
+        return *this;
+    }
+    constexpr basicVec2d rotated(T sa, T ca) const noexcept {
+        return basicVec2d(ix * ca - iy * sa, ix * sa + iy * ca);
+    }
+    constexpr basicVec2d &translate(T x, T y) noexcept {
+        *this += basicVec2d(x, y);
+        return *this;
+    }
+    constexpr basicVec2d translated(T x, T y) const noexcept {
+        return *this + basicVec2d(x, y);
+    }
+    basicVec2d &norm() noexcept {
+        *this /= length();
+        return *this;
+    }
+    basicVec2d normed() const noexcept { return *this / length(); }
+    constexpr basicVec2d &perp() noexcept { //+90 degrees
+        *this = perped();
+        return *this;
+    }
+    constexpr basicVec2d perped() const noexcept { return basicVec2d(-iy, ix); }
+    constexpr T dotProduct(const basicVec2d &v) const noexcept {
+        return ix * v.ix + iy * v.iy;
+    }
+    constexpr T det(const basicVec2d &v) const noexcept {
+        return ix * v.iy - iy * v.ix;
+    }
+    T angle(const basicVec2d &v) const noexcept {
+        // atan2(y, x) or atan2(sin, cos)
+        return -std::atan2(det(v), dotProduct(v));
+    }
+    T length() const noexcept { return std::sqrt(ix * ix + iy * iy); }
+    constexpr T length2() const noexcept { return ix * ix + iy * iy; }
+    T manhattanLength() const noexcept { return std::abs(ix) + std::abs(iy); }
+
+    constexpr basicVec2d operator+(const basicVec2d &v) const noexcept {
+        return basicVec2d(ix + v.ix, iy + v.iy);
+    }
+    constexpr basicVec2d &operator+=(const basicVec2d &v) noexcept {
+        ix += v.ix;
+        iy += v.iy;
+        return *this;
+    }
+    constexpr basicVec2d operator-(const basicVec2d &v) const noexcept {
+        return basicVec2d(ix - v.ix, iy - v.iy);
+    }
+    constexpr basicVec2d &operator-=(const basicVec2d &v) noexcept {
+        ix -= v.ix;
+        iy -= v.iy;
+        return *this;
+    }
+    constexpr basicVec2d operator-() const noexcept {
+        return basicVec2d(-ix, -iy);
+    }
+    constexpr basicVec2d operator*(T scale) const noexcept {
+        return basicVec2d(ix * scale, iy * scale);
+    }
+    constexpr basicVec2d &operator*=(T scale) noexcept {
+        ix *= scale;
+        iy *= scale;
+        return *this;
+    }
+    constexpr basicVec2d operator*(const basicMat23<T> &m) const noexcept {
+        return basicVec2d(ix * m.im11 + iy * m.im21 + 1 * m.im31,
+                          ix * m.im12 + iy * m.im22 + 1 * m.im32);
+    }
+    constexpr basicVec2d &operator*=(const basicMat23<T> &m) noexcept {
+        *this = *this * m;
+        return *this;
+    }
+    constexpr T operator*(const basicVec2d &v) const noexcept {
+        return dotProduct(v);
+    }
+    constexpr basicVec2d operator/(T divisor) const noexcept {
+        return basicVec2d(ix / divisor, iy / divisor);
+    }
+    constexpr basicVec2d &operator/=(T divisor) noexcept {
+        ix /= divisor;
+        iy /= divisor;
+        return *this;
+    }
+
+    friend basicMat23<T>;
 };
 
-class mat23 {
-    double im11, im12;
-    double im21, im22;
-    double im31, im32;
+template <typename T> class basicMat23 {
+    T im11, im12;
+    T im21, im22;
+    T im31, im32;
 
   public:
-    mat23(); // identity matrix
-    mat23(double m11, double m12, double m21, double m22, double m31,
-          double m32);
-    mat23(const vec2d &v1, const vec2d &v2);
-
-    mat23(const mat23 &v) = default;
-    mat23 &operator=(const mat23 &v) = default;
-    mat23(mat23 &&v) noexcept = default;
-    mat23 &operator=(mat23 &&v) noexcept = default;
-    ~mat23() = default;
-
-    operator QTransform() const;
-    double det() const; // check correctness
-    mat23 operator*(const mat23 &m) const;
-    mat23 &operator*=(const mat23 &m);
-
-    mat23 &identity();
-    mat23 &translate(const vec2d &dir);
-    mat23 &translate(double x, double y);
-    mat23 translated(const vec2d &dir) const;
-    mat23 translated(double x, double y) const;
-    mat23 &rotate(double angle);
-    mat23 rotated(double angle) const;
-    mat23 &scale(double scale);
-    mat23 &scale(double s1, double s2);
-    mat23 scaled(double scale) const;
-    mat23 scaled(double s1, double s2) const;
-
-    static mat23 makeIdentity();
-    static mat23 makeTranslate(const vec2d &dir);
-    static mat23 makeRotate(double angle);
-    static mat23 makeScale(double scale);
-    static mat23 makeScale(double s1, double s2);
-
-    friend vec2d;
+    // identity matrix
+    constexpr basicMat23() noexcept
+        : im11(1), im12(0), im21(0), im22(1), im31(0), im32(0) {}
+    constexpr basicMat23(T m11, T m12, T m21, T m22, T m31, T m32) noexcept
+        : im11(m11), im12(m12), im21(m21), im22(m22), im31(m31), im32(m32) {}
+    constexpr basicMat23(const basicVec2d<T> &v1,
+                         const basicVec2d<T> &v2) noexcept
+        : im11(v1.ix), im12(v2.ix), im21(v1.iy), im22(v2.iy), im31(0),
+          im32(0) {}
+
+    constexpr basicMat23(const basicMat23 &v) noexcept = default;
+    constexpr basicMat23 &operator=(const basicMat23 &v) noexcept = default;
+    constexpr basicMat23(basicMat23 &&v) noexcept = default;
+    constexpr basicMat23 &operator=(basicMat23 &&v) noexcept = default;
+    ~basicMat23() = default;
+
+    // check correctness. Is this formula applicable for 2x3 matrix? Seems that
+    // im31 and im32 members don't affect determinant
+    constexpr T det() const noexcept { return im11 * im22 - im12 * im21; }
+    // v * m * m.inverted() == v, for det() != 0
+    constexpr basicMat23 inverted() const noexcept {
+        T d = det();
+        T i11 = im22 / d, i12 = -im12 / d, i21 = -im21 / d, i22 = im11 / d;
+        return basicMat23(i11, i12, i21, i22, -(im31 * i11 + im32 * i21),
+                          -(im31 * i12 + im32 * i22));
+    }
+    constexpr basicMat23 operator*(const basicMat23 &m) const noexcept {
+        return basicMat23(im11 * m.im11 + im12 * m.im21,
+                          im11 * m.im12 + im12 * m.im22,
+                          im21 * m.im11 + im22 * m.im21,
+                          im21 * m.im12 + im22 * m.im22,
+                          im31 * m.im11 + im32 * m.im21 + 1 * m.im31,
+                          im31 * m.im12 + im32 * m.im22 + 1 * m.im32);
+    }
+    constexpr basicMat23 &operator*=(const basicMat23 &m) noexcept {
+        *this = *this * m;
+        return *this;
+    }
+
+    constexpr basicMat23 &identity() noexcept {
+        *this = makeIdentity();
+        return *this;
+    }
+    constexpr basicMat23 &translate(const basicVec2d<T> &dir) noexcept {
+        return translate(dir.ix, dir.iy);
+    }
+    constexpr basicMat23 &translate(T x, T y) noexcept {
+        im31 += x;
+        im32 += y;
+        return *this;
+    }
+    constexpr basicMat23 translated(const basicVec2d<T> &dir) const noexcept {
+        return translated(dir.ix, dir.iy);
+    }
+    constexpr basicMat23 translated(T x, T y) const noexcept {
+        return basicMat23(im11, im12, im21, im22, im31 + x, im32 + y);
+    }
+    basicMat23 &rotate(T angle) noexcept {
+        *this *= makeRotate(angle);
+        return *this;
+    }
+    basicMat23 rotated(T angle) const noexcept {
+        return *this * makeRotate(angle);
+    }
+    constexpr basicMat23 &rotate(T sa, T ca) noexcept {
+        *this *= makeRotate(sa, ca);
+        return *this;
+    }
+    constexpr basicMat23 rotated(T sa, T ca) const noexcept {
+        return *this * makeRotate(sa, ca);
+    }
+    constexpr basicMat23 &scale(T scale) noexcept {
+        *this = scaled(scale);
+        return *this;
+    }
+    constexpr basicMat23 &scale(T s1, T s2) noexcept {
+        *this = scaled(s1, s2);
+        return *this;
+    }
+    constexpr basicMat23 scaled(T scale) const noexcept {
+        return basicMat23(im11 * scale, im12 * scale, im21 * scale,
+                          im22 * scale, im31 * scale, im32 * scale);
+    }
+    constexpr basicMat23 scaled(T s1, T s2) const noexcept {
+        return basicMat23(im11 * s1, im12 * s2, im21 * s1, im22 * s2,
+                          im31 * s1, im32 * s2);
+    }
+
+    static constexpr basicMat23 makeIdentity() noexcept {
+        return basicMat23(1, 0, 0, 1, 0, 0);
+    }
+    static constexpr basicMat23
+    makeTranslate(const basicVec2d<T> &dir) noexcept {
+        return basicMat23(1, 0, 0, 1, dir.ix, dir.iy);
+    }
+    static basicMat23 makeRotate(T angle) noexcept {
+        return makeRotate(std::sin(angle), std::cos(angle));
+    }
+    static constexpr basicMat23 makeRotate(T sa, T ca) noexcept {
+        return basicMat23(ca, sa, -sa, ca, 0, 0);
+    }
+    static constexpr basicMat23 makeScale(T scale) noexcept {
+        return basicMat23(scale, 0, 0, scale, 0, 0);
+    }
+    static constexpr basicMat23 makeScale(T s1, T s2) noexcept {
+        return basicMat23(s1, 0, 0, s2, 0, 0);
+    }
+
+    // result[i] = points[i] * *this over whole arrays, in place is allowed.
+    // The SIMD kernels live in math2d.cpp.
+    void transform(const basicVec2d<T> *points, basicVec2d<T> *result,
+                   std::size_t count) const noexcept;
+    void transform(const basicVec2d<T> *points, basicVec2d<T> *result,
+                   std::size_t count, SimdLevel level) const noexcept;
+
+    friend basicVec2d<T>;
 };
+
+using vec2d = basicVec2d<real>;
+using mat23 = basicMat23<real>;
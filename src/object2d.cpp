@@ -1,55 +1,89 @@
 #include "object2d.h"
 #include "kdtree2d.h"
 #include "math2d.h"
-#include <QDebug>
+#include <algorithm>
 #include <cmath>
 #include <iterator>
 #include <list>
 #include <vector>
 
-object2d::~object2d() {
-    for (auto p : collisionModel)
-        delete p;
-
-    for (auto p : collisionModel_precalc)
-        delete p;
-
-    delete displayModel_texture;
-    delete displayModel_VBO;
-}
+object2d::~object2d() = default;
 
 vec2d object2d::getPos() const { return pos; }
 void object2d::setPos(const vec2d &newPos) {
+    wake();
     pos = newPos;
     collisionModel_expired = true;
 }
-double object2d::getAngle() const { return angle; }
-void object2d::setAngle(double newAngle) {
+real object2d::getAngle() const { return angle; }
+void object2d::setAngle(real newAngle) {
+    wake();
     angle = newAngle;
     collisionModel_expired = true;
 }
 
 vec2d object2d::getSpeed() const { return speed; }
-void object2d::setSpeed(vec2d newSpeed) { speed = newSpeed; }
-double object2d::getAngleSpeed() const { return angleSpeed; }
-void object2d::setAngleSpeed(double newAngleSpeed) {
+void object2d::setSpeed(vec2d newSpeed) {
+    wake();
+    speed = newSpeed;
+}
+real object2d::getAngleSpeed() const { return angleSpeed; }
+void object2d::setAngleSpeed(real newAngleSpeed) {
+    wake();
     angleSpeed = newAngleSpeed;
 }
 
-double object2d::getWeight() const { return weight; }
-void object2d::setWeight(double newWeight) { weight = newWeight; }
-double object2d::getWeightDistrib() const { return weightDistrib; }
-void object2d::setWeightDistrib(double newWeightDistrib) {
+real object2d::getWeight() const { return weight; }
+void object2d::setWeight(real newWeight) { weight = newWeight; }
+real object2d::getWeightDistrib() const { return weightDistrib; }
+void object2d::setWeightDistrib(real newWeightDistrib) {
     weightDistrib = newWeightDistrib;
 }
 bool object2d::getIsFixed() const { return isFixed; }
 void object2d::setIsFixed(bool newIsFixed) { isFixed = newIsFixed; }
+bool object2d::getIsSleeping() const { return isSleeping; }
+void object2d::setIsSleeping(bool newIsSleeping) {
+    isSleeping = newIsSleeping;
+    restTime = 0;
+    if (isSleeping) {
+        speed = vec2d();
+        angleSpeed = 0;
+    }
+}
+real object2d::getRestTime() const { return restTime; }
+void object2d::setRestTime(real newRestTime) { restTime = newRestTime; }
+void object2d::wake() {
+    if (isSleeping)
+        setIsSleeping(false);
+}
+void object2d::keepTransform() {
+    prevPos = pos;
+    prevAngle = angle;
+}
+vec2d object2d::getPrevPos() const { return prevPos; }
+real object2d::getPrevAngle() const { return prevAngle; }
+mat23 object2d::getInterpolatedMatrix(real alpha) const {
+    return mat23::makeRotate(prevAngle + (angle - prevAngle) * alpha)
+        .translated(prevPos + (pos - prevPos) * alpha);
+}
 
 void object2d::add(primitive2d *p) {
-    collisionModel.push_back(p);
+    switch (p->getType()) {
+    case PrimitiveType::Circle:
+        circles.push_back(*static_cast<circle2d *>(p));
+        break;
+    case PrimitiveType::Line:
+        lines.push_back(*static_cast<line2d *>(p));
+        break;
+    case PrimitiveType::Rectangle:
+        rectangles.push_back(*static_cast<rectangle2d *>(p));
+        break;
+    }
+    delete p;
 
     collisionModel_expired = true;
-    displayModel_VBO_expired = true;
+    collisionModel_localExpired = true;
+    wake();
 }
 
 void object2d::explosion(vec2d local_point) {
@@ -58,95 +92,125 @@ void object2d::explosion(vec2d local_point) {
         return v + temp.normed() * (std::exp(-0.5 * temp.length())) * 0.2;
     };
 
-    for (auto p : collisionModel) {
-        if (typeid(*p) == typeid(circle2d)) {
-            circle2d *c = static_cast<circle2d *>(p);
-            c->setPos(transform(c->getPos()));
-        } else if (typeid(*p) == typeid(line2d)) {
-            line2d *l = static_cast<line2d *>(p);
-            l->setP1(transform(l->getP1()));
-            l->setP2(transform(l->getP2()));
-        } else if (typeid(*p) == typeid(rectangle2d)) {
-            rectangle2d *r = static_cast<rectangle2d *>(p);
-            r->setPos(transform(r->getPos()));
-        }
+    for (auto &c : circles)
+        c.setPos(transform(c.getPos()));
+    for (auto &l : lines) {
+        l.setP1(transform(l.getP1()));
+        l.setP2(transform(l.getP2()));
     }
+    for (auto &r : rectangles)
+        r.setPos(transform(r.getPos()));
 
     collisionModel_expired = true;
-    displayModel_VBO_expired = true;
+    collisionModel_localExpired = true;
+    wake();
 }
 
 void object2d::applyForceLocal(vec2d force, vec2d point) {
-    double angleSpeedFactor = std::clamp(point.length() / getWeightDistrib() *
-                                             std::sin(point.angle(force)),
-                                         -1.0, 1.0);
-    double speedFactor = 1 - std::abs(angleSpeedFactor);
+    real angleSpeedFactor =
+        std::clamp<real>(point.length() / getWeightDistrib() *
+                             std::sin(point.angle(force)),
+                         -1, 1);
+    real speedFactor = 1 - std::abs(angleSpeedFactor);
 
     setAngleSpeed(getAngleSpeed() -
                   force.length() * angleSpeedFactor / getWeightDistrib());
     setSpeed(getSpeed() + force.rotated(getAngle()) * speedFactor);
 }
 
-void object2d::precalcCollisionModel() {
-    if (!collisionModel_expired)
-        return;
-
-    mat23 matrix;
-    matrix.rotate(angle);
-    matrix.translate(pos);
+// the object matrix applies to these points only, radii and sizes are
+// copied once here
+void object2d::precalcCollisionModel_points() {
+    circles_precalc = circles;
+    lines_precalc = lines;
+    rectangles_precalc = rectangles;
 
+    // the typed arrays may have moved since add
     collisionModel_precalc.clear();
-    for (auto p : collisionModel) {
-        collisionModel_precalc.push_back(p->clone());
-        collisionModel_precalc.back()->precalc(matrix);
-    }
+    for (auto &c : circles_precalc)
+        collisionModel_precalc.push_back(&c);
+    for (auto &l : lines_precalc)
+        collisionModel_precalc.push_back(&l);
+    for (auto &r : rectangles_precalc)
+        collisionModel_precalc.push_back(&r);
+    collisionModel_bBoxes.resize(collisionModel_precalc.size());
 
-    bool collisionModelBBox_init = false;
-    for (auto p : collisionModel_precalc) {
-        if (collisionModelBBox_init)
-            collisionModel_bBox += p->getBBox();
-        else {
-            collisionModel_bBox = p->getBBox();
-            collisionModelBBox_init = true;
-        }
-    }
+    collisionModel_points.clear();
+    pushPoints(circles, collisionModel_points);
+    pushPoints(lines, collisionModel_points);
+    pushPoints(rectangles, collisionModel_points);
+    collisionModel_points_precalc.resize(collisionModel_points.size());
+
+    collisionModel_localExpired = false;
+}
+
+void object2d::precalcCollisionModel() {
+    if (!collisionModel_expired)
+        return;
+    if (collisionModel_localExpired)
+        precalcCollisionModel_points();
+
+    mat23 matrix = mat23::makeRotate(angle).translated(pos);
+    collisionModel_matrix = matrix;
+    matrix.transform(collisionModel_points.data(),
+                     collisionModel_points_precalc.data(),
+                     collisionModel_points.size());
+
+    // one loop per type, no virtual calls
+    const vec2d *point = collisionModel_points_precalc.data();
+    bBox *bbox = collisionModel_bBoxes.data();
+    point = precalcPoints(circles_precalc, point, bbox);
+    bbox += circles_precalc.size();
+    point = precalcPoints(lines_precalc, point, bbox);
+    bbox += lines_precalc.size();
+    precalcPoints(rectangles_precalc, point, bbox);
+
+    if (!collisionModel_bBoxes.empty())
+        collisionModel_bBox = collisionModel_bBoxes.front();
+    for (const auto &bbox : collisionModel_bBoxes)
+        collisionModel_bBox += bbox;
 
     collisionModel_expired = false;
 }
 
 void object2d::precalcCollisionModel_KDTree(KDTree2d *kdtree) {
-    for (auto p : collisionModel_precalc)
-        kdtree->addItem(Item{p->getBBox(), this, p});
+    for (std::size_t i = 0; i < collisionModel_precalc.size(); i++)
+        kdtree->addItem(
+            Item{collisionModel_bBoxes[i], this, collisionModel_precalc[i]});
 }
 
-QOpenGLTexture *object2d::getDisplayModel_texture() {
-    return displayModel_texture;
+const std::vector<primitive2d *> &object2d::getCollisionModel_precalc() const {
+    return collisionModel_precalc;
+}
+const std::vector<bBox> &object2d::getCollisionModel_bBoxes() const {
+    return collisionModel_bBoxes;
+}
+const mat23 &object2d::getCollisionModel_matrix() const {
+    return collisionModel_matrix;
 }
-QOpenGLBuffer *object2d::getDisplayModel_VBO() { return displayModel_VBO; }
-
 void object2d::precalcDebug_VBO(std::vector<float> &vertices) {
-    for (auto p : collisionModel_precalc) {
-        if (typeid(*p) == typeid(circle2d))
-            pushCircleVertices(vertices, static_cast<circle2d *>(p));
-        else if (typeid(*p) == typeid(line2d))
-            pushLineVertices(vertices, static_cast<line2d *>(p));
-        else if (typeid(*p) == typeid(rectangle2d))
-            pushRectangleVertices(vertices, static_cast<rectangle2d *>(p));
-        // pushBBoxVertices(vertices, p->getBBox());
-    }
+    for (const auto &c : circles_precalc)
+        pushCircleVertices(vertices, &c);
+    for (const auto &l : lines_precalc)
+        pushLineVertices(vertices, &l);
+    for (const auto &r : rectangles_precalc)
+        pushRectangleVertices(vertices, &r);
+    // for (const auto &bbox : collisionModel_bBoxes)
+    //     pushBBoxVertices(vertices, bbox);
     // pushBBoxVertices(vertices, collisionModel_bBox);
 }
 
-void object2d::precalcDisplayModel() {
-    if (!displayModel_VBO_expired)
-        return;
+void object2d::precalcDebug_VBO(std::vector<float> &vertices, real alpha) {
+    std::size_t begin = vertices.size();
+    precalcDebug_VBO(vertices);
 
-    delete displayModel_VBO;
-    displayModel_VBO = nullptr;
-
-    // TODO: precalcVBO for nonDebug
-
-    displayModel_VBO_expired = false;
+    mat23 matrix =
+        collisionModel_matrix.inverted() * getInterpolatedMatrix(alpha);
+    for (std::size_t i = begin; i < vertices.size(); i += 2) {
+        vec2d vertex = vec2d(vertices[i], vertices[i + 1]) * matrix;
+        vertices[i] = vertex.x();
+        vertices[i + 1] = vertex.y();
+    }
 }
 
 bBox object2d::getBBox() { return collisionModel_bBox; }
@@ -165,7 +229,7 @@ vec2d object2d::worldToObject(vec2d worldPoint) {
 collisionObjectsPoint::collisionObjectsPoint(object2d *obj1, object2d *obj2,
                                              const vec2d &pos,
                                              const vec2d &normal1,
-                                             const vec2d &normal2, double depth)
+                                             const vec2d &normal2, real depth)
     : obj1(obj1), obj2(obj2), pos(pos), normal1(normal1), normal2(normal2),
       depth(depth) {}
 object2d *collisionObjectsPoint::getObj1() const { return obj1; }
@@ -182,5 +246,5 @@ vec2d collisionObjectsPoint::getNormal2() const { return normal2; }
 void collisionObjectsPoint::setNormal2(const vec2d &newNormal2) {
     normal2 = newNormal2;
 }
-double collisionObjectsPoint::getDepth() const { return depth; }
-void collisionObjectsPoint::setDepth(double newDepth) { depth = newDepth; }
\ No newline at end of file
+real collisionObjectsPoint::getDepth() const { return depth; }
+void collisionObjectsPoint::setDepth(real newDepth) { depth = newDepth; }
\ No newline at end of file
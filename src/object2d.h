@@ -2,36 +2,50 @@
 
 #include "math2d.h"
 #include "primitive2d.h"
-#include <QOpenGLBuffer>
-#include <QOpenGLTexture>
-#include <list>
+#include <vector>
 
 class collisionObjectsPoint;
 class KDTree2d;
 
 class object2d {
     vec2d pos;
-    double angle;
+    real angle = 0;
 
     vec2d speed;
-    double angleSpeed;
+    real angleSpeed = 0;
 
-    double weight = 1;
-    double weightDistrib = 1;
+    real weight = 1;
+    real weightDistrib = 1;
     bool isFixed = false;
+    bool isSleeping = false;
+    real restTime = 0; // below the world2d sleep speeds, while awake
 
-    std::list<primitive2d *> collisionModel; // in local coords
+    // transform before the last world2d step, for render interpolation
+    vec2d prevPos;
+    real prevAngle = 0;
 
-    // precalc collisionModel  values
+    // contiguous per primitive type, in local coords
+    std::vector<circle2d> circles;
+    std::vector<line2d> lines;
+    std::vector<rectangle2d> rectangles;
+
+    // precalc collisionModel  values, the same layout in world coords
     mat23 collisionModel_matrix;
-    std::list<primitive2d *> collisionModel_precalc; // in world coords
+    std::vector<circle2d> circles_precalc;
+    std::vector<line2d> lines_precalc;
+    std::vector<rectangle2d> rectangles_precalc;
+    std::vector<primitive2d *> collisionModel_precalc; // circles, lines, rects
+    std::vector<bBox> collisionModel_bBoxes;           // parallel to the above
     bBox collisionModel_bBox;
     bool collisionModel_expired = true;
 
-    // precalc displayModel values in object coords
-    QOpenGLTexture *displayModel_texture = nullptr;
-    QOpenGLBuffer *displayModel_VBO = nullptr;
-    bool displayModel_VBO_expired = true;
+    // circle centers, line ends and rectangle corners in the storage order,
+    // transformed in one batch. Rebuilt when the local model changes.
+    std::vector<vec2d> collisionModel_points;
+    std::vector<vec2d> collisionModel_points_precalc;
+    bool collisionModel_localExpired = true;
+
+    void precalcCollisionModel_points();
 
   public:
     object2d() = default;
@@ -43,35 +57,47 @@ class object2d {
 
     vec2d getPos() const;
     void setPos(const vec2d &newPos);
-    double getAngle() const;
-    void setAngle(double newAngle);
+    real getAngle() const;
+    void setAngle(real newAngle);
 
     vec2d getSpeed() const;
     void setSpeed(vec2d newSpeed);
-    double getAngleSpeed() const;
-    void setAngleSpeed(double newAngleSpeed);
+    real getAngleSpeed() const;
+    void setAngleSpeed(real newAngleSpeed);
 
-    double getWeight() const;
-    void setWeight(double newWeight);
-    double getWeightDistrib() const;
-    void setWeightDistrib(double newWeightDistrib);
+    real getWeight() const;
+    void setWeight(real newWeight);
+    real getWeightDistrib() const;
+    void setWeightDistrib(real newWeightDistrib);
     bool getIsFixed() const;
     void setIsFixed(bool newIsFixed);
-
-    void add(primitive2d *p);
+    bool getIsSleeping() const;
+    // a sleeping object stands still, the setters and forces wake it
+    void setIsSleeping(bool newIsSleeping);
+    real getRestTime() const;
+    void setRestTime(real newRestTime);
+    void wake();
+    void keepTransform(); // as the previous one
+    vec2d getPrevPos() const;
+    real getPrevAngle() const;
+    // alpha between the previous transform and the current one
+    mat23 getInterpolatedMatrix(real alpha) const;
+
+    void add(primitive2d *p); // copied in the typed storage and deleted
     void explosion(vec2d local_point);
     void applyForceLocal(vec2d force, vec2d forcePoint);
 
-    QOpenGLTexture *getDisplayModel_texture();
-    QOpenGLBuffer *getDisplayModel_VBO();
-
     void precalcCollisionModel();
 
     void precalcDebug_VBO(std::vector<float> &vertices);
-    void precalcDisplayModel();
+    // the precalculated model moved to getInterpolatedMatrix(alpha)
+    void precalcDebug_VBO(std::vector<float> &vertices, real alpha);
 
     void precalcCollisionModel_KDTree(KDTree2d *kdtree);
-    // void precalcDisplayModel_KDTree(KDTree2d *kdtree);
+    const std::vector<primitive2d *> &getCollisionModel_precalc() const;
+    const std::vector<bBox> &getCollisionModel_bBoxes() const;
+    // the transform the precalculated model is at
+    const mat23 &getCollisionModel_matrix() const;
 
     bBox getBBox();
     vec2d objectToWorld(vec2d objectPoint);
@@ -86,11 +112,11 @@ class collisionObjectsPoint {
     vec2d pos;     // absolute coordinate system
     vec2d normal1; // normal from obj1
     vec2d normal2; // normal from obj2
-    double depth;  // max depth to obj
+    real depth;    // max depth to obj
   public:
     collisionObjectsPoint(object2d *obj1, object2d *obj2, const vec2d &pos,
                           const vec2d &normal1, const vec2d &normal2,
-                          double depth);
+                          real depth);
     collisionObjectsPoint() = default;
     collisionObjectsPoint(const collisionObjectsPoint &) = default;
     collisionObjectsPoint &operator=(const collisionObjectsPoint &) = default;
@@ -108,6 +134,6 @@ class collisionObjectsPoint {
     void setNormal1(const vec2d &newNormal1);
     vec2d getNormal2() const;
     void setNormal2(const vec2d &newNormal2);
-    double getDepth() const;
-    void setDepth(double newDepth1);
+    real getDepth() const;
+    void setDepth(real newDepth1);
 };
@@ -1,22 +1,27 @@
 #include "primitive2d.h"
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <limits>
+#include <utility>
 
 // ----------------------
 // bBox
 // ----------------------
 
-bBox::bBox(double minX, double minY, double maxX, double maxY)
+bBox::bBox(real minX, real minY, real maxX, real maxY)
     : minX(minX), minY(minY), maxX(maxX), maxY(maxY) {}
-double bBox::getMinX() const { return minX; }
-double bBox::getMinY() const { return minY; }
-double bBox::getMaxX() const { return maxX; }
-double bBox::getMaxY() const { return maxY; }
-void bBox::setMinX(double value) { minX = value; }
-void bBox::setMinY(double value) { minY = value; }
-void bBox::setMaxX(double value) { maxX = value; }
-void bBox::setMaxY(double value) { maxY = value; }
-double bBox::width() const { return getMaxX() - getMinX(); }
-double bBox::height() const { return getMaxY() - getMinY(); }
+real bBox::getMinX() const { return minX; }
+real bBox::getMinY() const { return minY; }
+real bBox::getMaxX() const { return maxX; }
+real bBox::getMaxY() const { return maxY; }
+void bBox::setMinX(real value) { minX = value; }
+void bBox::setMinY(real value) { minY = value; }
+void bBox::setMaxX(real value) { maxX = value; }
+void bBox::setMaxY(real value) { maxY = value; }
+real bBox::width() const { return getMaxX() - getMinX(); }
+real bBox::height() const { return getMaxY() - getMinY(); }
+real bBox::perimeter() const { return 2 * (width() + height()); }
 
 bBox bBox::operator+(const bBox &other) const {
     return bBox(std::min(getMinX(), other.getMinX()),
@@ -47,17 +52,22 @@ bool bBox::intersect(const vec2d &point) const {
            point.y() > getMinY() && point.y() < getMaxY();
 }
 
+bool bBox::contains(const bBox &other) const {
+    return getMinX() <= other.getMinX() && getMinY() <= other.getMinY() &&
+           getMaxX() >= other.getMaxX() && getMaxY() >= other.getMaxY();
+}
+
 // ----------------------
 // circle2d
 // ----------------------
 
-circle2d::circle2d(const vec2d &pos, double radius)
-    : pos(pos), radius(radius) {}
+circle2d::circle2d(const vec2d &pos, real radius)
+    : primitive2d(typeTag), pos(pos), radius(radius) {}
 
 vec2d circle2d::getPos() const { return pos; }
 void circle2d::setPos(const vec2d &newPos) { pos = newPos; }
-double circle2d::getRadius() const { return radius; }
-void circle2d::setRadius(double newRadius) { radius = newRadius; }
+real circle2d::getRadius() const { return radius; }
+void circle2d::setRadius(real newRadius) { radius = newRadius; }
 
 void circle2d::precalc(const mat23 &matrix) { pos *= matrix; }
 
@@ -72,7 +82,8 @@ bBox circle2d::getBBox() const {
 // line2d
 // ----------------------
 
-line2d::line2d(const vec2d &p1, const vec2d &p2) : p1(p1), p2(p2) {}
+line2d::line2d(const vec2d &p1, const vec2d &p2)
+    : primitive2d(typeTag), p1(p1), p2(p2) {}
 
 const vec2d &line2d::getP1() const { return p1; }
 void line2d::setP1(const vec2d &newP1) { p1 = newP1; }
@@ -95,15 +106,15 @@ bBox line2d::getBBox() const {
 // rectangle2d
 // ----------------------
 
-rectangle2d::rectangle2d(const vec2d &pos, const vec2d &size, double angle)
-    : pos(pos), size(size), angle(angle) {}
+rectangle2d::rectangle2d(const vec2d &pos, const vec2d &size, real angle)
+    : primitive2d(typeTag), pos(pos), size(size), angle(angle) {}
 
 const vec2d &rectangle2d::getPos() const { return pos; }
 void rectangle2d::setPos(const vec2d &newPos) { pos = newPos; }
 const vec2d &rectangle2d::getSize() const { return size; }
 void rectangle2d::setSize(const vec2d &newSize) { size = newSize; }
-double rectangle2d::getAngle() const { return angle; }
-void rectangle2d::setAngle(double newAngle) { angle = newAngle; }
+real rectangle2d::getAngle() const { return angle; }
+void rectangle2d::setAngle(real newAngle) { angle = newAngle; }
 
 const vec2d &rectangle2d::P1() const { return p1; }
 void rectangle2d::setP1(const vec2d &newP1) { p1 = newP1; }
@@ -120,11 +131,7 @@ void rectangle2d::precalc(const mat23 &matrix) {
     p3 = vec2d(-size.x() / 2, -size.y() / 2);
     p4 = vec2d(-size.x() / 2, +size.y() / 2);
 
-    mat23 rectM;
-    rectM.rotate(angle);
-    rectM.translate(pos);
-
-    rectM *= matrix;
+    mat23 rectM = mat23::makeRotate(angle).translated(pos) * matrix;
 
     p1 *= rectM;
     p2 *= rectM;
@@ -141,6 +148,65 @@ bBox rectangle2d::getBBox() const {
     return bBox(minX, minY, maxX, maxY);
 }
 
+// ----------------------
+// batch precalc
+// ----------------------
+
+void pushPoints(const std::vector<circle2d> &circles,
+                std::vector<vec2d> &points) {
+    for (const auto &c : circles)
+        points.push_back(c.getPos());
+}
+
+void pushPoints(const std::vector<line2d> &lines, std::vector<vec2d> &points) {
+    for (const auto &l : lines) {
+        points.push_back(l.getP1());
+        points.push_back(l.getP2());
+    }
+}
+
+// the rectangle rotation is applied once here, not on every precalc
+void pushPoints(const std::vector<rectangle2d> &rectangles,
+                std::vector<vec2d> &points) {
+    for (auto r : rectangles) {
+        r.precalc(mat23());
+        points.insert(end(points), {r.P1(), r.P2(), r.P3(), r.P4()});
+    }
+}
+
+const vec2d *precalcPoints(std::vector<circle2d> &circles,
+                           const vec2d *points, bBox *bboxes) {
+    for (auto &c : circles) {
+        c.setPos(*points++);
+        *bboxes++ = c.getBBox();
+    }
+    return points;
+}
+
+const vec2d *precalcPoints(std::vector<line2d> &lines, const vec2d *points,
+                           bBox *bboxes) {
+    for (auto &l : lines) {
+        l.setP1(points[0]);
+        l.setP2(points[1]);
+        points += 2;
+        *bboxes++ = l.getBBox();
+    }
+    return points;
+}
+
+const vec2d *precalcPoints(std::vector<rectangle2d> &rectangles,
+                           const vec2d *points, bBox *bboxes) {
+    for (auto &r : rectangles) {
+        r.setP1(points[0]);
+        r.setP2(points[1]);
+        r.setP3(points[2]);
+        r.setP4(points[3]);
+        points += 4;
+        *bboxes++ = r.getBBox();
+    }
+    return points;
+}
+
 // ----------------------
 // collisionPrimitivesPoint
 // ----------------------
@@ -148,7 +214,7 @@ bBox rectangle2d::getBBox() const {
 collisionPrimitivesPoint::collisionPrimitivesPoint(const vec2d &pos,
                                                    const vec2d &normal1,
                                                    const vec2d &normal2,
-                                                   double depth)
+                                                   real depth)
     : pos(pos), normal1(normal1), normal2(normal2), depth(depth) {}
 const vec2d &collisionPrimitivesPoint::getNormal1() const { return normal1; }
 void collisionPrimitivesPoint::setNormal1(const vec2d &newNormal1) {
@@ -158,8 +224,8 @@ const vec2d &collisionPrimitivesPoint::getNormal2() const { return normal2; }
 void collisionPrimitivesPoint::setNormal2(const vec2d &newNormal2) {
     normal2 = newNormal2;
 }
-double collisionPrimitivesPoint::getDepth() const { return depth; }
-void collisionPrimitivesPoint::setDepth(double newDepth) { depth = newDepth; }
+real collisionPrimitivesPoint::getDepth() const { return depth; }
+void collisionPrimitivesPoint::setDepth(real newDepth) { depth = newDepth; }
 const vec2d &collisionPrimitivesPoint::getPos() const { return pos; }
 void collisionPrimitivesPoint::setPos(const vec2d &newPos) { pos = newPos; }
 void collisionPrimitivesPoint::swap() { std::swap(normal1, normal2); }
@@ -171,15 +237,15 @@ void collisionPrimitivesPoint::swap() { std::swap(normal1, normal2); }
 bool collisionPrimitives(const circle2d &c1, const circle2d &c2,
                          collisionPrimitivesPoint &point) {
     vec2d dist = c2.getPos() - c1.getPos();
-    double distLength2 = dist.length2();
-    double radius = c2.getRadius() + c1.getRadius();
-    double radius2 = radius * radius;
+    real distLength2 = dist.length2();
+    real radius = c2.getRadius() + c1.getRadius();
+    real radius2 = radius * radius;
     if (distLength2 > radius2)
         return false;
     else {
-        double distLength = std::sqrt(distLength2);
+        real distLength = std::sqrt(distLength2);
         vec2d normal = dist / distLength;
-        double depth = radius - distLength;
+        real depth = radius - distLength;
         point = collisionPrimitivesPoint(
             c1.getPos() +
                 dist * (c1.getRadius() / (c2.getRadius() + c1.getRadius())),
@@ -195,7 +261,7 @@ bool collisionPrimitives(const circle2d &c1, const line2d &l2,
 
     vec2d v1 = c1.getPos() - l2.getP1();
     vec2d v2 = l2.getP2() - l2.getP1();
-    double projL = v1.dotProduct(v2) / v2.length();
+    real projL = v1.dotProduct(v2) / v2.length();
 
     if (projL >= 0 && projL <= v2.length()) {
         vec2d v3 = v2 / v2.length() * projL;
@@ -250,28 +316,28 @@ bool collisionPrimitives(const line2d &l1, const circle2d &c2,
 
 bool collisionPrimitives(const line2d &l1, const line2d &l2,
                          collisionPrimitivesPoint &point) {
-    double run1 = l1.getP2().x() - l1.getP1().x();
-    if (std::abs(run1) < std::numeric_limits<double>::epsilon())
+    real run1 = l1.getP2().x() - l1.getP1().x();
+    if (std::abs(run1) < std::numeric_limits<real>::epsilon())
         run1 = 0.1;
-    double run2 = l2.getP2().x() - l2.getP1().x();
-    if (std::abs(run2) < std::numeric_limits<double>::epsilon())
+    real run2 = l2.getP2().x() - l2.getP1().x();
+    if (std::abs(run2) < std::numeric_limits<real>::epsilon())
         run2 = 0.1;
 
-    double rise1 = l1.getP2().y() - l1.getP1().y();
-    if (std::abs(rise1) < std::numeric_limits<double>::epsilon())
+    real rise1 = l1.getP2().y() - l1.getP1().y();
+    if (std::abs(rise1) < std::numeric_limits<real>::epsilon())
         rise1 = 0.1;
-    double a1 = rise1 / run1;
+    real a1 = rise1 / run1;
 
-    double rise2 = l2.getP2().y() - l2.getP1().y();
-    if (std::abs(rise2) < std::numeric_limits<double>::epsilon())
+    real rise2 = l2.getP2().y() - l2.getP1().y();
+    if (std::abs(rise2) < std::numeric_limits<real>::epsilon())
         rise2 = 0.1;
-    double a2 = rise2 / run2;
+    real a2 = rise2 / run2;
 
-    double b1 = -a1 * l1.getP2().x() + l1.getP2().y();
-    double b2 = -a2 * l2.getP2().x() + l2.getP2().y();
+    real b1 = -a1 * l1.getP2().x() + l1.getP2().y();
+    real b2 = -a2 * l2.getP2().x() + l2.getP2().y();
 
-    double x_intersect = (b2 - b1) / (a1 - a2);
-    double y_intersect = a1 * x_intersect + b1;
+    real x_intersect = (b2 - b1) / (a1 - a2);
+    real y_intersect = a1 * x_intersect + b1;
 
     if (((x_intersect >= std::min(l1.getP1().x(), l1.getP2().x()) &&
           x_intersect <= std::max(l1.getP1().x(), l1.getP2().x())) ||
@@ -286,14 +352,14 @@ bool collisionPrimitives(const line2d &l1, const line2d &l2,
         point.setNormal1((l1.getP2() - l1.getP1()).perp().norm());
         point.setNormal2((l2.getP2() - l2.getP1()).perp().norm());
 
-        double dp11 =
+        real dp11 =
             point.getNormal1().dotProduct(l2.getP1() - point.getPos());
-        double dp12 =
+        real dp12 =
             point.getNormal1().dotProduct(l2.getP2() - point.getPos());
 
-        double dp21 =
+        real dp21 =
             point.getNormal2().dotProduct(l1.getP1() - point.getPos());
-        double dp22 =
+        real dp22 =
             point.getNormal2().dotProduct(l1.getP2() - point.getPos());
 
         point.setDepth(std::max(std::abs(std::min(dp21, dp22)),
@@ -315,8 +381,8 @@ bool collisionPrimitives(const rectangle2d &r1, const circle2d &c2,
     vec2d vX = r1.P2() - r1.P3();
     vec2d vY = r1.P4() - r1.P3();
     vec2d vC = c2.getPos() - r1.P3();
-    double projX = vC.dotProduct(vX) / r1.getSize().x();
-    double projY = vC.dotProduct(vY) / r1.getSize().y();
+    real projX = vC.dotProduct(vX) / r1.getSize().x();
+    real projY = vC.dotProduct(vY) / r1.getSize().y();
 
     if (projX >= 0 && projX <= r1.getSize().x()) {
         if (projY < r1.getSize().y() / 2 && projY + c2.getRadius() >= 0) {
@@ -350,7 +416,7 @@ bool collisionPrimitives(const rectangle2d &r1, const circle2d &c2,
         }
     } else if (projX < 0 && projY < 0) {
         vec2d v = c2.getPos() - r1.P3();
-        double vL = v.length();
+        real vL = v.length();
         if (vL <= c2.getRadius()) {
             point.setPos(r1.P3());
             point.setNormal1(v / vL);
@@ -360,7 +426,7 @@ bool collisionPrimitives(const rectangle2d &r1, const circle2d &c2,
         }
     } else if (projX < 0 && projY > r1.getSize().y()) {
         vec2d v = c2.getPos() - r1.P4();
-        double vL = v.length();
+        real vL = v.length();
         if (vL <= c2.getRadius()) {
             point.setPos(r1.P4());
             point.setNormal1(v / vL);
@@ -370,7 +436,7 @@ bool collisionPrimitives(const rectangle2d &r1, const circle2d &c2,
         }
     } else if (projX > r1.getSize().x() && projY > r1.getSize().y()) {
         vec2d v = c2.getPos() - r1.P1();
-        double vL = v.length();
+        real vL = v.length();
         if (vL <= c2.getRadius()) {
             point.setPos(r1.P1());
             point.setNormal1(v / vL);
@@ -380,7 +446,7 @@ bool collisionPrimitives(const rectangle2d &r1, const circle2d &c2,
         }
     } else if (projX > r1.getSize().x() && projY < 0) {
         vec2d v = c2.getPos() - r1.P2();
-        double vL = v.length();
+        real vL = v.length();
         if (vL <= c2.getRadius()) {
             point.setPos(r1.P2());
             point.setNormal1(v / vL);
@@ -415,46 +481,76 @@ bool collisionPrimitives(const rectangle2d &r1, const rectangle2d &r2,
     return false;
 }
 
+namespace {
+
+using collisionFunction = bool (*)(const primitive2d &, const primitive2d &,
+                                   collisionPrimitivesPoint &);
+using collisionBatchFunction = void (*)(const primitive2d *const *,
+                                        const primitive2d *const *,
+                                        std::size_t, std::uint8_t *,
+                                        collisionPrimitivesPoint *);
+
+template <typename T1, typename T2>
+bool collisionCast(const primitive2d &p1, const primitive2d &p2,
+                   collisionPrimitivesPoint &point) {
+    return collisionPrimitives(static_cast<const T1 &>(p1),
+                               static_cast<const T2 &>(p2), point);
+}
+
+template <typename T1, typename T2>
+void collisionBatch(const primitive2d *const *p1,
+                    const primitive2d *const *p2, std::size_t count,
+                    std::uint8_t *hits, collisionPrimitivesPoint *points) {
+    for (std::size_t i = 0; i < count; i++)
+        hits[i] = collisionPrimitives(static_cast<const T1 &>(*p1[i]),
+                                      static_cast<const T2 &>(*p2[i]),
+                                      points[i]);
+}
+
+// N x N tables of the overloads above, [type1][type2]
+template <typename Types> struct collisionTables;
+template <typename... T> struct collisionTables<std::tuple<T...>> {
+    static constexpr std::size_t n = sizeof...(T);
+
+    template <typename T1>
+    static constexpr std::array<collisionFunction, n> row() {
+        return {&collisionCast<T1, T>...};
+    }
+    template <typename T1>
+    static constexpr std::array<collisionBatchFunction, n> batchRow() {
+        return {&collisionBatch<T1, T>...};
+    }
+
+    static constexpr std::array<std::array<collisionFunction, n>, n> single{
+        row<T>()...};
+    static constexpr std::array<std::array<collisionBatchFunction, n>, n>
+        batch{batchRow<T>()...};
+};
+using tables = collisionTables<primitiveTypes>;
+
+template <std::size_t... I>
+constexpr bool tagsMatch(std::index_sequence<I...>) {
+    return ((std::tuple_element_t<I, primitiveTypes>::typeTag ==
+             PrimitiveType(I)) &&
+            ...);
+}
+static_assert(tagsMatch(std::make_index_sequence<primitiveTypesNumber>()),
+              "PrimitiveType must follow the primitiveTypes order");
+
+} // namespace
+
 bool collisionPrimitives(const primitive2d &p1, const primitive2d &p2,
                          collisionPrimitivesPoint &point) {
-    if (typeid(p1) == typeid(circle2d)) {
-        if (typeid(p2) == typeid(circle2d))
-            return collisionPrimitives(static_cast<const circle2d &>(p1),
-                                       static_cast<const circle2d &>(p2),
-                                       point);
-        else if (typeid(p2) == typeid(line2d))
-            return collisionPrimitives(static_cast<const circle2d &>(p1),
-                                       static_cast<const line2d &>(p2), point);
-        else if (typeid(p2) == typeid(rectangle2d))
-            return collisionPrimitives(static_cast<const circle2d &>(p1),
-                                       static_cast<const rectangle2d &>(p2),
-                                       point);
-    } else if (typeid(p1) == typeid(line2d)) {
-        if (typeid(p2) == typeid(circle2d))
-            return collisionPrimitives(static_cast<const line2d &>(p1),
-                                       static_cast<const circle2d &>(p2),
-                                       point);
-        else if (typeid(p2) == typeid(line2d))
-            return collisionPrimitives(static_cast<const line2d &>(p1),
-                                       static_cast<const line2d &>(p2), point);
-        else if (typeid(p2) == typeid(rectangle2d))
-            return collisionPrimitives(static_cast<const line2d &>(p1),
-                                       static_cast<const rectangle2d &>(p2),
-                                       point);
-    } else if (typeid(p1) == typeid(rectangle2d)) {
-        if (typeid(p2) == typeid(circle2d))
-            return collisionPrimitives(static_cast<const rectangle2d &>(p1),
-                                       static_cast<const circle2d &>(p2),
-                                       point);
-        else if (typeid(p2) == typeid(line2d))
-            return collisionPrimitives(static_cast<const rectangle2d &>(p1),
-                                       static_cast<const line2d &>(p2), point);
-        else if (typeid(p2) == typeid(rectangle2d))
-            return collisionPrimitives(static_cast<const rectangle2d &>(p1),
-                                       static_cast<const rectangle2d &>(p2),
-                                       point);
-    }
-    return false;
+    return tables::single[std::size_t(p1.getType())]
+                         [std::size_t(p2.getType())](p1, p2, point);
+}
+
+void collisionPrimitives(PrimitiveType type1, PrimitiveType type2,
+                         const primitive2d *const *p1,
+                         const primitive2d *const *p2, std::size_t count,
+                         std::uint8_t *hits, collisionPrimitivesPoint *points) {
+    tables::batch[std::size_t(type1)][std::size_t(type2)](p1, p2, count, hits,
+                                                         points);
 }
 
 // ----------------------
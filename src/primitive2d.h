@@ -1,11 +1,13 @@
 #pragma once
 
 #include "math2d.h"
+#include <cstdint>
+#include <tuple>
 #include <vector>
 
 class bBox {
-    double minX, minY;
-    double maxX, maxY;
+    real minX, minY;
+    real maxX, maxY;
 
   public:
     bBox() = default;
@@ -15,75 +17,89 @@ class bBox {
     bBox &operator=(bBox &&rect) noexcept = default;
     ~bBox() = default;
 
-    bBox(double minX, double minY, double maxX, double maxY);
-    double getMinX() const;
-    double getMinY() const;
-    double getMaxX() const;
-    double getMaxY() const;
-    void setMinX(double value);
-    void setMinY(double value);
-    void setMaxX(double value);
-    void setMaxY(double value);
-    double width() const;
-    double height() const;
+    bBox(real minX, real minY, real maxX, real maxY);
+    real getMinX() const;
+    real getMinY() const;
+    real getMaxX() const;
+    real getMaxY() const;
+    void setMinX(real value);
+    void setMinY(real value);
+    void setMaxX(real value);
+    void setMaxY(real value);
+    real width() const;
+    real height() const;
+    real perimeter() const;
 
     bBox operator+(const bBox &other) const;
     bBox &operator+=(const bBox &other);
 
     bool intersect(const bBox &other) const;
     bool intersect(const vec2d &point) const;
+    bool contains(const bBox &other) const;
 };
 
 class collisionPrimitivesPoint {
     vec2d pos;     // absolute coordinate system
     vec2d normal1; // normal from primitive1
     vec2d normal2; // normal from primitive2
-    double depth;  // penetration depth
+    real depth;    // penetration depth
   public:
     collisionPrimitivesPoint() = default;
     collisionPrimitivesPoint(const vec2d &pos, const vec2d &normal1,
-                             const vec2d &normal2, double depth);
+                             const vec2d &normal2, real depth);
     const vec2d &getPos() const;
     void setPos(const vec2d &newPos);
     const vec2d &getNormal1() const;
     void setNormal1(const vec2d &newNormal);
     const vec2d &getNormal2() const;
     void setNormal2(const vec2d &newNormal);
-    double getDepth() const;
-    void setDepth(double newDepth);
+    real getDepth() const;
+    void setDepth(real newDepth);
     void swap();
 };
 
+// index of the shape in primitiveTypes
+enum class PrimitiveType : std::uint8_t { Circle, Line, Rectangle };
+
 class primitive2d {
+    PrimitiveType type;
+
+  protected:
+    explicit primitive2d(PrimitiveType type) : type(type) {}
+
   public:
     virtual ~primitive2d() = default;
 
+    PrimitiveType getType() const { return type; }
+
     virtual void precalc(const mat23 &matrix) = 0;
     virtual primitive2d *clone() const = 0;
     virtual bBox getBBox() const = 0;
 };
 
-class circle2d : public primitive2d {
+class circle2d final : public primitive2d {
     vec2d pos;
-    double radius;
+    real radius;
 
   public:
-    circle2d(const vec2d &pos, double radius);
+    static constexpr PrimitiveType typeTag = PrimitiveType::Circle;
+    circle2d(const vec2d &pos, real radius);
 
     vec2d getPos() const;
     void setPos(const vec2d &newPos);
-    double getRadius() const;
-    void setRadius(double newRadius);
+    real getRadius() const;
+    void setRadius(real newRadius);
 
     void precalc(const mat23 &matrix) override;
     primitive2d *clone() const override;
     bBox getBBox() const override;
 };
 
-class line2d : public primitive2d {
+class line2d final : public primitive2d {
     vec2d p1, p2;
 
   public:
+    static constexpr PrimitiveType typeTag = PrimitiveType::Line;
     line2d(const vec2d &p1, const vec2d &p2);
 
     const vec2d &getP1() const;
@@ -96,22 +112,23 @@ class line2d : public primitive2d {
     bBox getBBox() const override;
 };
 
-class rectangle2d : public primitive2d {
+class rectangle2d final : public primitive2d {
     vec2d pos;
     vec2d size;
-    double angle;
+    real angle;
 
     vec2d p1, p2, p3, p4;
 
   public:
-    rectangle2d(const vec2d &pos, const vec2d &size, double angle);
+    static constexpr PrimitiveType typeTag = PrimitiveType::Rectangle;
+    rectangle2d(const vec2d &pos, const vec2d &size, real angle);
 
     const vec2d &getPos() const;
     void setPos(const vec2d &newPos);
     const vec2d &getSize() const;
     void setSize(const vec2d &newSize);
-    double getAngle() const;
-    void setAngle(double newAngle);
+    real getAngle() const;
+    void setAngle(real newAngle);
 
     const vec2d &P1() const;
     void setP1(const vec2d &newP1);
@@ -127,6 +144,27 @@ class rectangle2d : public primitive2d {
     bBox getBBox() const override;
 };
 
+// every shape, in PrimitiveType order. A new shape needs a tag, an entry
+// here and collisionPrimitives overloads against every shape.
+using primitiveTypes = std::tuple<circle2d, line2d, rectangle2d>;
+constexpr std::size_t primitiveTypesNumber =
+    std::tuple_size_v<primitiveTypes>;
+
+// Whole arrays through one mat23::transform: circle centers, line ends and
+// rectangle corners in object coords. precalcPoints sets the transformed
+// points on the world copies, writes their boxes and returns the next point.
+void pushPoints(const std::vector<circle2d> &circles,
+                std::vector<vec2d> &points);
+void pushPoints(const std::vector<line2d> &lines, std::vector<vec2d> &points);
+void pushPoints(const std::vector<rectangle2d> &rectangles,
+                std::vector<vec2d> &points);
+const vec2d *precalcPoints(std::vector<circle2d> &circles,
+                           const vec2d *points, bBox *bboxes);
+const vec2d *precalcPoints(std::vector<line2d> &lines, const vec2d *points,
+                           bBox *bboxes);
+const vec2d *precalcPoints(std::vector<rectangle2d> &rectangles,
+                           const vec2d *points, bBox *bboxes);
+
 bool collisionPrimitives(const circle2d &c1, const circle2d &c2,
                          collisionPrimitivesPoint &point);
 bool collisionPrimitives(const circle2d &c1, const line2d &l2,
@@ -148,8 +186,15 @@ bool collisionPrimitives(const rectangle2d &r1, const line2d &l2,
 bool collisionPrimitives(const rectangle2d &r1, const rectangle2d &r2,
                          collisionPrimitivesPoint &point);
 
+// one indexed call through a table generated from primitiveTypes
 bool collisionPrimitives(const primitive2d &p1, const primitive2d &p2,
                          collisionPrimitivesPoint &point);
+// count pairs where every p1[i] is type1 and every p2[i] is type2, one
+// kernel for the whole batch
+void collisionPrimitives(PrimitiveType type1, PrimitiveType type2,
+                         const primitive2d *const *p1,
+                         const primitive2d *const *p2, std::size_t count,
+                         std::uint8_t *hits, collisionPrimitivesPoint *points);
 
 void pushCircleVertices(std::vector<float> &vertices, const circle2d *p);
 void pushLineVertices(std::vector<float> &vertices, const line2d *p);
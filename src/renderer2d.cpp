@@ -0,0 +1,53 @@
+#include "renderer2d.h"
+#include <QOpenGLFunctions>
+
+renderer2d::~renderer2d() { destroy(); }
+
+void renderer2d::upload(std::size_t i, const std::vector<float> &vertices) {
+    int size = vertices.size() * sizeof(GLfloat);
+
+    if (debug_VBO_array[i] == nullptr) {
+        debug_VBO_array[i] = new QOpenGLBuffer();
+        debug_VBO_array[i]->setUsagePattern(QOpenGLBuffer::DynamicDraw);
+        debug_VBO_array[i]->create();
+    }
+
+    debug_VBO_array[i]->bind();
+    // grow only, smaller frames are written into the existing storage
+    if (debug_VBO_array[i]->size() < size)
+        debug_VBO_array[i]->allocate(vertices.data(), size);
+    else
+        debug_VBO_array[i]->write(0, vertices.data(), size);
+    debug_VBO_array[i]->release();
+
+    debug_vertexCount_array[i] = vertices.size() / 2;
+}
+
+void renderer2d::precalcDebug_VBO(const world2d &world) {
+    for (std::size_t i = 0; i < debug_VBO_number; i++)
+        upload(i, world.getDebug_vertices(i));
+}
+
+void renderer2d::precalcDebug_VBO(const snapshot2d &snapshot, real alpha) {
+    upload(0, snapshot.debug_vertices_array[0]);
+    snapshot.interpolateDebug_vertices(alpha, debug_interpolated);
+    upload(1, debug_interpolated);
+}
+
+QOpenGLBuffer *renderer2d::getDebug_VBO(std::size_t index) {
+    return debug_VBO_array[index];
+}
+std::size_t renderer2d::getDebug_vertexCount(std::size_t index) {
+    return debug_vertexCount_array[index];
+}
+QVector4D renderer2d::getDebug_color(std::size_t index) {
+    return debug_colors_array[index];
+}
+
+void renderer2d::destroy() {
+    for (std::size_t i = 0; i < debug_VBO_number; i++) {
+        delete debug_VBO_array[i];
+        debug_VBO_array[i] = nullptr;
+        debug_vertexCount_array[i] = 0;
+    }
+}
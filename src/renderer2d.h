@@ -0,0 +1,35 @@
+#pragma once
+
+#include "world2d.h"
+#include <QOpenGLBuffer>
+#include <QVector4D>
+
+// GL side of world2d: uploads the debug geometry generated by the physics
+// into buffers that are reused between frames
+class renderer2d {
+    QOpenGLBuffer *debug_VBO_array[debug_VBO_number]{nullptr, nullptr};
+    std::size_t debug_vertexCount_array[debug_VBO_number]{0, 0};
+    QVector4D debug_colors_array[debug_VBO_number]{QVector4D(0, 1, 0, 1),
+                                                   QVector4D(1, 1, 1, 1)};
+
+    // a snapshot's objects debug vertices at the frame's interpolation
+    std::vector<float> debug_interpolated;
+
+    void upload(std::size_t index, const std::vector<float> &vertices);
+
+  public:
+    renderer2d() = default;
+    renderer2d(const renderer2d &) = delete;
+    renderer2d &operator=(const renderer2d &) = delete;
+    renderer2d(renderer2d &&) noexcept = delete;
+    renderer2d &operator=(renderer2d &&) noexcept = delete;
+    ~renderer2d();
+
+    void precalcDebug_VBO(const world2d &world);
+    // the objects between the snapshot's previous and current transforms
+    void precalcDebug_VBO(const snapshot2d &snapshot, real alpha);
+    QOpenGLBuffer *getDebug_VBO(std::size_t index);
+    std::size_t getDebug_vertexCount(std::size_t index);
+    QVector4D getDebug_color(std::size_t index);
+    void destroy(); // requires current GL context
+};
@@ -0,0 +1,14 @@
+#include "simd2d.h"
+
+SimdLevel simdLevel() {
+#ifdef SIMD2D_X86
+    static const SimdLevel level = __builtin_cpu_supports("avx2")
+                                       ? SimdLevel::AVX2
+                                   : __builtin_cpu_supports("sse2")
+                                       ? SimdLevel::SSE2
+                                       : SimdLevel::Scalar;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Instruction sets of the batch kernels, picked at runtime. Kernels of every
+// level give bit identical results, none of them contracts to FMA.
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                              \
+    (defined(__x86_64__) || defined(__i386__))
+#define SIMD2D_X86
+#endif
+
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+SimdLevel simdLevel(); // best one supported by this cpu
@@ -0,0 +1,39 @@
+#include "snapshot2d.h"
+#include <algorithm>
+
+mat23 objectTransform2d::getInterpolatedMatrix(real alpha) const {
+    return mat23::makeRotate(prevAngle + (angle - prevAngle) * alpha)
+        .translated(prevPos + (pos - prevPos) * alpha);
+}
+
+real snapshot2d::getInterpolation(clock::time_point now) const {
+    double elapsed =
+        std::chrono::duration<double, std::milli>(now - stepTime).count();
+    return std::clamp(elapsed / tick, 0.0, 1.0);
+}
+
+void snapshot2d::interpolateDebug_vertices(real alpha,
+                                           std::vector<float> &result) const {
+    result = debug_vertices_array[1];
+    for (const auto &range : debugRanges) {
+        mat23 matrix = range.toLocal *
+                       transforms[range.transform].getInterpolatedMatrix(alpha);
+        for (std::uint32_t i = range.begin; i < range.end; i += 2) {
+            vec2d vertex = vec2d(result[i], result[i + 1]) * matrix;
+            result[i] = vertex.x();
+            result[i + 1] = vertex.y();
+        }
+    }
+}
+
+snapshot2d &snapshotBuffer2d::getWriteBuffer() { return snapshots[back]; }
+
+void snapshotBuffer2d::publish() {
+    back = middle.exchange(back | fresh, std::memory_order_acq_rel) & ~fresh;
+}
+
+const snapshot2d &snapshotBuffer2d::read() {
+    if (middle.load(std::memory_order_relaxed) & fresh)
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~fresh;
+    return snapshots[front];
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "math2d.h"
+#include "object2d.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr std::size_t debug_VBO_number = 2;
+
+struct objectTransform2d {
+    const object2d *object; // identity only, may be deleted meanwhile
+    vec2d pos, prevPos;
+    real angle, prevAngle;
+
+    // as object2d::getInterpolatedMatrix
+    mat23 getInterpolatedMatrix(real alpha) const;
+};
+
+// debug vertices [begin, end) that follow transforms[transform], toLocal
+// takes them back from where they were made
+struct debugRange2d {
+    std::uint32_t begin, end; // floats of debug_vertices_array[1]
+    std::uint32_t transform;
+    mat23 toLocal;
+};
+
+// What the render side needs of the world after a step. Written by the
+// stepping thread, read by the render one.
+struct snapshot2d {
+    using clock = std::chrono::steady_clock;
+
+    std::uint64_t steps = 0; // of the world so far
+    // wall time the current transforms were due at, the previous ones are a
+    // tick of milliseconds older
+    clock::time_point stepTime;
+    double tick = 10;
+    std::vector<objectTransform2d> transforms;
+    // GL_LINES vertex pairs as world2d::getDebug_vertices, the objects and
+    // connections ones at their current transforms
+    std::vector<float> debug_vertices_array[debug_VBO_number];
+    std::vector<debugRange2d> debugRanges;
+
+    // the wall time since stepTime in ticks, [0, 1], later than a tick when
+    // the stepping thread falls behind stays at the current transforms
+    real getInterpolation(clock::time_point now) const;
+    // debug_vertices_array[1] with every range at alpha between the
+    // previous and current transforms
+    void interpolateDebug_vertices(real alpha,
+                                   std::vector<float> &result) const;
+};
+
+// Lock free triple buffer, one writer and one reader thread. The writer
+// fills its buffer and swaps it with the middle one, the reader swaps its
+// buffer with the middle one when that holds a newer snapshot. Neither
+// waits for the other.
+class snapshotBuffer2d {
+    snapshot2d snapshots[3];
+    static constexpr std::uint8_t fresh = 4; // published, not read yet
+    std::atomic<std::uint8_t> middle{1};
+    std::uint8_t back = 0;  // the writer's
+    std::uint8_t front = 2; // the reader's
+
+  public:
+    snapshot2d &getWriteBuffer(); // writer only, holds an old snapshot
+    void publish();               // writer only
+    // reader only, the latest published snapshot, valid until the next call
+    const snapshot2d &read();
+};
@@ -0,0 +1,201 @@
+#include "spatialhash2d.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+int SpatialHash2d::cellCoord(real value) const {
+    return std::clamp<real>(std::floor(value * inverseCellSize), -1e9, 1e9);
+}
+
+std::uint64_t SpatialHash2d::cellKey(int x, int y) {
+    return std::uint64_t(std::uint32_t(x)) << 32 | std::uint32_t(y);
+}
+
+SpatialHash2d::Cell &SpatialHash2d::findCell(std::uint64_t key) {
+    std::size_t mask = table.size() - 1;
+    std::size_t slot = (key * 0x9e3779b97f4a7c15) >> 32 & mask;
+    while (table[slot].count && table[slot].key != key)
+        slot = (slot + 1) & mask;
+    return table[slot];
+}
+
+template <typename F>
+void SpatialHash2d::forCells(const bBox &bbox, F &&callback) const {
+    int maxX = cellCoord(bbox.getMaxX());
+    int maxY = cellCoord(bbox.getMaxY());
+    for (int x = cellCoord(bbox.getMinX()); x <= maxX; x++)
+        for (int y = cellCoord(bbox.getMinY()); y <= maxY; y++)
+            callback(cellKey(x, y));
+}
+
+bool SpatialHash2d::isLarge(const bBox &bbox) const {
+    return cellCoord(bbox.getMaxX()) - cellCoord(bbox.getMinX()) >=
+               largeCellsMax ||
+           cellCoord(bbox.getMaxY()) - cellCoord(bbox.getMinY()) >=
+               largeCellsMax;
+}
+
+// the cell of the min corner of the intersection, one for every pair
+bool SpatialHash2d::reportedHere(const bBox &bbox1, const bBox &bbox2,
+                                 std::uint64_t key) const {
+    return cellKey(cellCoord(std::max(bbox1.getMinX(), bbox2.getMinX())),
+                   cellCoord(std::max(bbox1.getMinY(), bbox2.getMinY()))) ==
+           key;
+}
+
+void SpatialHash2d::build() {
+    cellSize = 1;
+    if (!items.empty()) {
+        sizes.clear();
+        for (const auto &item : items)
+            sizes.push_back(
+                std::max(item.bbox.width(), item.bbox.height()));
+        auto median = begin(sizes) + sizes.size() / 2;
+        std::nth_element(begin(sizes), median, end(sizes));
+        if (*median > 0)
+            cellSize = *median;
+    }
+    inverseCellSize = 1 / cellSize;
+
+    itemLarge.resize(items.size());
+    if (large)
+        large->items.clear();
+    std::size_t references = 0;
+    for (std::uint32_t i = 0; i < items.size(); i++) {
+        const bBox &bbox = items[i].bbox;
+        itemLarge[i] = isLarge(bbox);
+        if (itemLarge[i]) {
+            if (!large)
+                large = std::make_unique<SpatialHash2d>();
+            large->items.push_back(items[i]);
+        } else
+            references += (cellCoord(bbox.getMaxX()) -
+                           cellCoord(bbox.getMinX()) + 1) *
+                          (cellCoord(bbox.getMaxY()) -
+                           cellCoord(bbox.getMinY()) + 1);
+    }
+    // the median of the large items is bigger, so the nesting ends
+    if (large)
+        large->build();
+
+    // at most half full
+    table.assign(std::bit_ceil(2 * references + 1), Cell{});
+    for (std::uint32_t i = 0; i < items.size(); i++)
+        if (!itemLarge[i])
+            forCells(items[i].bbox, [this](std::uint64_t key) {
+                Cell &cell = findCell(key);
+                cell.key = key;
+                cell.count++;
+            });
+
+    std::uint32_t offset = 0;
+    for (auto &cell : table)
+        if (cell.count) {
+            cell.begin = offset;
+            offset += cell.count;
+        }
+
+    cellItems.resize(offset);
+    for (std::uint32_t i = 0; i < items.size(); i++)
+        if (!itemLarge[i])
+            forCells(items[i].bbox, [this, i](std::uint64_t key) {
+                Cell &cell = findCell(key);
+                cellItems[cell.begin + cell.fill++] = i;
+            });
+}
+
+void SpatialHash2d::update(const std::list<object2d *> &objects) {
+    items.clear();
+    for (auto object : objects) {
+        const auto &model = object->getCollisionModel_precalc();
+        const auto &bboxes = object->getCollisionModel_bBoxes();
+        for (std::size_t i = 0; i < model.size(); i++)
+            items.push_back({bboxes[i], object, model[i]});
+    }
+    build();
+}
+
+void SpatialHash2d::findPairs(std::vector<std::pair<Item, Item>> &result) {
+    auto pushPair = [&result](const Item &item1, const Item &item2) {
+        if (item1.object < item2.object)
+            result.push_back({item1, item2});
+        else
+            result.push_back({item2, item1});
+    };
+
+    for (const auto &cell : table)
+        for (std::uint32_t i = cell.begin; i < cell.begin + cell.count; i++)
+            for (std::uint32_t j = i + 1; j < cell.begin + cell.count; j++) {
+                const Item &item1 = items[cellItems[i]];
+                const Item &item2 = items[cellItems[j]];
+                if (item1.object != item2.object &&
+                    item1.bbox.intersect(item2.bbox) &&
+                    reportedHere(item1.bbox, item2.bbox, cell.key))
+                    pushPair(item1, item2);
+            }
+
+    if (!large || large->items.empty())
+        return;
+
+    large->findPairs(result);
+    for (std::uint32_t i = 0; i < items.size(); i++)
+        if (!itemLarge[i]) {
+            largeResult.clear();
+            large->intersect(items[i].bbox, largeResult);
+            for (const auto &item : largeResult)
+                if (item.object != items[i].object)
+                    pushPair(items[i], item);
+        }
+}
+
+void SpatialHash2d::intersect(const bBox &bbox, std::vector<Item> &result) {
+    if (items.empty())
+        return;
+
+    // cheaper to check every item than to walk a huge query
+    double cells = (bbox.width() * inverseCellSize + 1) *
+                   (bbox.height() * inverseCellSize + 1);
+    if (cells > items.size()) {
+        for (std::uint32_t i = 0; i < items.size(); i++)
+            if (!itemLarge[i] && items[i].bbox.intersect(bbox))
+                result.push_back(items[i]);
+        if (large)
+            large->intersect(bbox, result);
+        return;
+    }
+
+    forCells(bbox, [this, &bbox, &result](std::uint64_t key) {
+        const Cell &cell = findCell(key);
+        for (std::uint32_t i = cell.begin; i < cell.begin + cell.count; i++) {
+            const Item &item = items[cellItems[i]];
+            if (item.bbox.intersect(bbox) &&
+                reportedHere(item.bbox, bbox, key))
+                result.push_back(item);
+        }
+    });
+    if (large)
+        large->intersect(bbox, result);
+}
+
+void SpatialHash2d::precalcDebug_VBO(std::vector<float> &vertices) {
+    if (large)
+        large->precalcDebug_VBO(vertices);
+    for (const auto &cell : table)
+        if (cell.count) {
+            real x = std::int32_t(cell.key >> 32) * cellSize;
+            real y = std::int32_t(cell.key) * cellSize;
+            pushBBoxVertices(vertices,
+                             bBox(x, y, x + cellSize, y + cellSize));
+        }
+}
+
+std::size_t SpatialHash2d::memoryUsage() const {
+    return items.capacity() * sizeof(Item) + table.capacity() * sizeof(Cell) +
+           cellItems.capacity() * sizeof(std::uint32_t) +
+           itemLarge.capacity() * sizeof(std::uint8_t) +
+           largeResult.capacity() * sizeof(Item) +
+           sizes.capacity() * sizeof(real) +
+           (large ? sizeof(SpatialHash2d) + large->memoryUsage() : 0);
+}
+
+real SpatialHash2d::getCellSize() const { return cellSize; }
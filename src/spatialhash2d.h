@@ -0,0 +1,56 @@
+#pragma once
+
+#include "broadphase2d.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Uniform grid hashed into an open addressing table, rebuilt on every
+// update. The cell size is the median primitive size, so equal primitives
+// cover up to four cells. Items of a cell are stored contiguously by a
+// counting pass, a pair is reported only from the cell holding the min
+// corner of the boxes intersection. Items spanning too many cells go to a
+// nested coarser grid instead.
+class SpatialHash2d : public broadphase2d {
+    static constexpr int largeCellsMax = 4; // per axis
+
+    struct Cell {
+        std::uint64_t key;
+        std::uint32_t begin; // in cellItems
+        std::uint32_t count; // 0 for an empty slot
+        std::uint32_t fill;
+    };
+
+    real cellSize = 1;
+    real inverseCellSize = 1;
+
+    std::vector<Item> items;
+    std::vector<Cell> table; // power of two size
+    std::vector<std::uint32_t> cellItems;
+    std::vector<std::uint8_t> itemLarge;  // parallel to items
+    std::unique_ptr<SpatialHash2d> large; // cell size of the large items
+    std::vector<Item> largeResult;
+    std::vector<real> sizes; // build only
+
+    int cellCoord(real value) const;
+    static std::uint64_t cellKey(int x, int y);
+    Cell &findCell(std::uint64_t key); // or the empty slot to put it in
+    template <typename F> void forCells(const bBox &bbox, F &&callback) const;
+    bool isLarge(const bBox &bbox) const;
+    void build();
+    bool reportedHere(const bBox &bbox1, const bBox &bbox2,
+                      std::uint64_t key) const;
+
+  public:
+    SpatialHash2d() = default;
+    SpatialHash2d(const SpatialHash2d &) = delete;
+    SpatialHash2d &operator=(const SpatialHash2d &) = delete;
+
+    void update(const std::list<object2d *> &objects) override;
+    void findPairs(std::vector<std::pair<Item, Item>> &result) override;
+    void intersect(const bBox &bbox, std::vector<Item> &result) override;
+    void precalcDebug_VBO(std::vector<float> &vertices) override;
+    std::size_t memoryUsage() const override;
+
+    real getCellSize() const;
+};
@@ -0,0 +1,259 @@
+#include "sweepandprune2d.h"
+#include <algorithm>
+#include <bit>
+
+bool SweepAndPrune2d::Endpoint::operator<(const Endpoint &other) const {
+    // min before max on equal values, touching boxes overlap like in bBox
+    return value < other.value ||
+           (value == other.value && !isMax() && other.isMax());
+}
+
+std::uint64_t SweepAndPrune2d::pairKey(std::uint32_t proxy1,
+                                       std::uint32_t proxy2) {
+    if (proxy1 > proxy2)
+        std::swap(proxy1, proxy2);
+    return std::uint64_t(proxy1) << 32 | proxy2;
+}
+
+// ----------------------
+// proxies
+// ----------------------
+
+std::uint32_t SweepAndPrune2d::createProxy(const Item &item) {
+    std::uint32_t proxy;
+    if (freeProxies.empty()) {
+        proxy = proxies.size();
+        proxies.push_back(Proxy());
+    } else {
+        proxy = freeProxies.back();
+        freeProxies.pop_back();
+    }
+    proxies[proxy].item = item;
+    proxies[proxy].alive = true;
+
+    // appended after every other endpoint, sorted in place on the update
+    for (auto &axisEndpoints : endpoints) {
+        axisEndpoints.push_back({0, proxy << 1});
+        axisEndpoints.push_back({0, proxy << 1 | 1});
+    }
+    return proxy;
+}
+
+void SweepAndPrune2d::destroyProxy(std::uint32_t proxy) {
+    proxies[proxy].alive = false;
+    freeProxies.push_back(proxy);
+}
+
+// ----------------------
+// sort
+// ----------------------
+
+void SweepAndPrune2d::overlapBegins(std::uint32_t proxy1,
+                                    std::uint32_t proxy2) {
+    const Item &item1 = proxies[proxy1].item;
+    const Item &item2 = proxies[proxy2].item;
+    if (item1.object != item2.object && item1.bbox.intersect(item2.bbox))
+        pairs.insert(pairKey(proxy1, proxy2));
+}
+
+void SweepAndPrune2d::overlapEnds(std::uint32_t proxy1, std::uint32_t proxy2) {
+    pairs.erase(pairKey(proxy1, proxy2));
+}
+
+// insertion sort, almost linear for a coherent order. Every endpoint pair is
+// swapped once at most, the overlap on the other axis is checked against the
+// new boxes, so the pairs are right after both axes are sorted. Gives up
+// after more than budget swaps, the endpoints stay a permutation but the
+// pairs are wrong until rebuild.
+bool SweepAndPrune2d::sortAxis(int axis, std::size_t budget) {
+    auto &e = endpoints[axis];
+    std::size_t swaps = 0;
+    for (std::size_t i = 1; i < e.size(); i++) {
+        Endpoint key = e[i];
+        std::size_t j = i;
+        for (; j > 0 && key < e[j - 1]; j--) {
+            const Endpoint &other = e[j - 1];
+            if (!key.isMax() && other.isMax())
+                overlapBegins(key.proxy(), other.proxy());
+            else if (key.isMax() && !other.isMax())
+                overlapEnds(key.proxy(), other.proxy());
+            e[j] = other;
+        }
+        e[j] = key;
+        swaps += i - j;
+        if (swaps > budget)
+            return false;
+    }
+    return true;
+}
+
+// full sort and sweep along x, for the first update, for big insertions and
+// under big motion where the insertion sort goes quadratic. The x overlap
+// follows from the order, the active boxes keep their y range inline since
+// this loop runs n times the boxes crossing a vertical line.
+void SweepAndPrune2d::rebuild() {
+    for (auto &axisEndpoints : endpoints)
+        std::sort(begin(axisEndpoints), end(axisEndpoints));
+
+    pairs.clear();
+    active.clear();
+    activeSlots.resize(proxies.size());
+    for (const auto &endpoint : endpoints[0]) {
+        std::uint32_t proxy = endpoint.proxy();
+        if (endpoint.isMax()) {
+            std::uint32_t slot = activeSlots[proxy];
+            active[slot] = active.back();
+            activeSlots[active[slot].proxy] = slot;
+            active.pop_back();
+            continue;
+        }
+
+        const Item &item = proxies[proxy].item;
+        real minY = item.bbox.getMinY(), maxY = item.bbox.getMaxY();
+        for (const auto &other : active)
+            if ((other.minY <= maxY) & (minY <= other.maxY) &
+                (other.object != item.object))
+                pairs.insert(pairKey(proxy, other.proxy));
+        activeSlots[proxy] = active.size();
+        active.push_back({minY, maxY, item.object, proxy});
+    }
+}
+
+// ----------------------
+// broadphase2d
+// ----------------------
+
+void SweepAndPrune2d::update(const std::list<object2d *> &objects) {
+    stamp++;
+
+    // destroy proxies of removed objects and of objects with a changed model
+    std::size_t destroyed = 0;
+    for (auto object : objects) {
+        auto it = objectProxies.find(object);
+        if (it == objectProxies.end())
+            continue;
+
+        if (it->second.proxies.size() ==
+            object->getCollisionModel_precalc().size())
+            it->second.stamp = stamp;
+        else {
+            for (auto proxy : it->second.proxies)
+                destroyProxy(proxy);
+            destroyed += it->second.proxies.size();
+            objectProxies.erase(it);
+        }
+    }
+    for (auto it = objectProxies.begin(); it != objectProxies.end();)
+        if (it->second.stamp != stamp) {
+            for (auto proxy : it->second.proxies)
+                destroyProxy(proxy);
+            destroyed += it->second.proxies.size();
+            it = objectProxies.erase(it);
+        } else
+            it++;
+
+    // before the freed proxies are reused
+    if (destroyed) {
+        for (auto &axisEndpoints : endpoints)
+            std::erase_if(axisEndpoints, [this](const Endpoint &endpoint) {
+                return !proxies[endpoint.proxy()].alive;
+            });
+        std::erase_if(pairs, [this](std::uint64_t key) {
+            return !proxies[key >> 32].alive ||
+                   !proxies[key & 0xffffffff].alive;
+        });
+    }
+
+    std::size_t created = 0;
+    for (auto object : objects) {
+        auto [it, inserted] = objectProxies.try_emplace(object);
+        it->second.stamp = stamp;
+        if (!inserted && object->getIsSleeping())
+            continue; // the proxies did not move
+
+        const auto &model = object->getCollisionModel_precalc();
+        const auto &bboxes = object->getCollisionModel_bBoxes();
+        for (std::size_t i = 0; i < model.size(); i++) {
+            Item item{bboxes[i], object, model[i]};
+            if (inserted)
+                it->second.proxies.push_back(createProxy(item));
+            else
+                proxies[it->second.proxies[i]].item = item;
+        }
+        if (inserted)
+            created += model.size();
+    }
+
+    for (int axis = 0; axis < 2; axis++)
+        for (auto &endpoint : endpoints[axis]) {
+            const bBox &bbox = proxies[endpoint.proxy()].item.bbox;
+            if (axis == 0)
+                endpoint.value =
+                    endpoint.isMax() ? bbox.getMaxX() : bbox.getMinX();
+            else
+                endpoint.value =
+                    endpoint.isMax() ? bbox.getMaxY() : bbox.getMinY();
+        }
+
+    // past n log n swaps, as under big motion, a full sort is cheaper. A
+    // failed sort costs about a rebuild, so after one the next sorts are
+    // skipped for 1, 3, 7 ... frames while the motion stays big
+    std::size_t budget =
+        endpoints[0].size() * std::bit_width(endpoints[0].size());
+    if (created * 8 > endpoints[0].size())
+        rebuild();
+    else if (skippedSorts < sortsToSkip) {
+        skippedSorts++;
+        rebuild();
+    } else if (sortAxis(0, budget) && sortAxis(1, budget))
+        sortsToSkip = 0;
+    else {
+        sortsToSkip = std::min<std::size_t>(sortsToSkip * 2 + 1, 63);
+        skippedSorts = 0;
+        rebuild();
+    }
+}
+
+void SweepAndPrune2d::findPairs(std::vector<std::pair<Item, Item>> &result) {
+    for (auto key : pairs) {
+        const Item &item1 = proxies[key >> 32].item;
+        const Item &item2 = proxies[key & 0xffffffff].item;
+        if (item1.object < item2.object)
+            result.push_back({item1, item2});
+        else
+            result.push_back({item2, item1});
+    }
+}
+
+// every box starting left of bbox's right side along x
+void SweepAndPrune2d::intersect(const bBox &bbox, std::vector<Item> &result) {
+    for (const auto &endpoint : endpoints[0]) {
+        if (endpoint.value > bbox.getMaxX())
+            break;
+        const Item &item = proxies[endpoint.proxy()].item;
+        if (!endpoint.isMax() && item.bbox.intersect(bbox))
+            result.push_back(item);
+    }
+}
+
+void SweepAndPrune2d::precalcDebug_VBO(std::vector<float> &vertices) {
+    for (const auto &proxy : proxies)
+        if (proxy.alive)
+            pushBBoxVertices(vertices, proxy.item.bbox);
+}
+
+std::size_t SweepAndPrune2d::memoryUsage() const {
+    std::size_t objectsSize = 0;
+    for (const auto &[object, objectProxy] : objectProxies)
+        objectsSize += sizeof(object) + sizeof(objectProxy) +
+                       objectProxy.proxies.capacity() * sizeof(std::uint32_t);
+
+    return proxies.capacity() * sizeof(Proxy) + objectsSize +
+           (endpoints[0].capacity() + endpoints[1].capacity()) *
+               sizeof(Endpoint) +
+           pairs.bucket_count() * sizeof(void *) +
+           pairs.size() * (sizeof(std::uint64_t) + sizeof(void *)) +
+           (freeProxies.capacity() + activeSlots.capacity()) *
+               sizeof(std::uint32_t) +
+           active.capacity() * sizeof(Active);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "broadphase2d.h"
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Sweep and prune over both axes. The min/max endpoints of every primitive
+// box stay sorted between frames and are fixed up by insertion sort, every
+// swap of a min and a max endpoint starts or ends an overlap, so the pairs
+// are updated incrementally. Cheap while bodies move a small part of their
+// size per frame, under bigger motion the update falls back to a full sort.
+class SweepAndPrune2d : public broadphase2d {
+    struct Proxy {
+        Item item;
+        bool alive = false;
+    };
+
+    struct Endpoint {
+        real value;
+        std::uint32_t data; // proxy << 1 | isMax
+
+        std::uint32_t proxy() const { return data >> 1; }
+        bool isMax() const { return data & 1; }
+        bool operator<(const Endpoint &other) const;
+    };
+
+    struct Active {
+        real minY, maxY;
+        object2d *object;
+        std::uint32_t proxy;
+    };
+
+    struct ObjectProxies {
+        std::vector<std::uint32_t> proxies; // in collisionModel order
+        std::size_t stamp = 0;
+    };
+
+    std::vector<Proxy> proxies;
+    std::vector<std::uint32_t> freeProxies;
+    std::vector<Endpoint> endpoints[2];
+    std::unordered_set<std::uint64_t> pairs; // proxy1 < proxy2
+    std::vector<Active> active;              // rebuild only
+    std::vector<std::uint32_t> activeSlots;  // proxy -> index in active
+
+    std::unordered_map<object2d *, ObjectProxies> objectProxies;
+    std::size_t stamp = 0;
+    std::size_t sortsToSkip = 0, skippedSorts = 0; // after a failed sort
+
+    std::uint32_t createProxy(const Item &item);
+    void destroyProxy(std::uint32_t proxy);
+
+    bool sortAxis(int axis, std::size_t budget);
+    void rebuild();
+    void overlapBegins(std::uint32_t proxy1, std::uint32_t proxy2);
+    void overlapEnds(std::uint32_t proxy1, std::uint32_t proxy2);
+    static std::uint64_t pairKey(std::uint32_t proxy1, std::uint32_t proxy2);
+
+  public:
+    SweepAndPrune2d() = default;
+
+    void update(const std::list<object2d *> &objects) override;
+    void findPairs(std::vector<std::pair<Item, Item>> &result) override;
+    void intersect(const bBox &bbox, std::vector<Item> &result) override;
+    void precalcDebug_VBO(std::vector<float> &vertices) override;
+    std::size_t memoryUsage() const override;
+};
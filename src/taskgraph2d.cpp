@@ -0,0 +1,37 @@
+#include "taskgraph2d.h"
+
+std::size_t
+taskGraph2d::add(std::function<void()> fn,
+                 std::initializer_list<std::size_t> dependencies) {
+    std::size_t node = nodes.size();
+    nodes.emplace_back().fn = std::move(fn);
+    for (auto dependency : dependencies)
+        nodes[dependency].successors.push_back(node);
+    nodes[node].dependencies = dependencies.size();
+    return node;
+}
+
+// successors are spawned before the task is done, so the group never runs
+// empty in between
+void taskGraph2d::spawn(threadPool2d &pool, taskGroup2d &group,
+                        std::size_t node) {
+    pool.spawn(group, [this, &pool, &group, node]() {
+        nodes[node].fn();
+        for (auto successor : nodes[node].successors)
+            if (--nodes[successor].remaining == 0)
+                spawn(pool, group, successor);
+    });
+}
+
+void taskGraph2d::run(threadPool2d &pool) {
+    for (auto &node : nodes)
+        node.remaining = node.dependencies;
+
+    taskGroup2d group;
+    for (std::size_t node = 0; node < nodes.size(); node++)
+        if (nodes[node].dependencies == 0)
+            spawn(pool, group, node);
+    pool.wait(group);
+}
+
+void taskGraph2d::clear() { nodes.clear(); }
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "threadpool2d.h"
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+// Tasks with explicit dependencies, a task runs on the pool once every task
+// it depends on is done. Independent tasks run concurrently.
+
+class taskGraph2d {
+    struct Node {
+        std::function<void()> fn;
+        std::vector<std::size_t> successors;
+        std::size_t dependencies = 0;
+        std::atomic<std::size_t> remaining{0};
+    };
+    std::deque<Node> nodes;
+
+    void spawn(threadPool2d &pool, taskGroup2d &group, std::size_t node);
+
+  public:
+    // dependencies are ids returned by add before
+    std::size_t add(std::function<void()> fn,
+                    std::initializer_list<std::size_t> dependencies = {});
+    // every task once, returns when all are done
+    void run(threadPool2d &pool);
+    void clear();
+};
@@ -0,0 +1,111 @@
+#include "threadpool2d.h"
+
+namespace {
+
+struct poolThread {
+    const threadPool2d *pool = nullptr;
+    std::size_t index = 0;
+};
+thread_local poolThread currentThread;
+
+} // namespace
+
+bool taskGroup2d::done() const { return pending == 0; }
+
+threadPool2d::threadPool2d(std::size_t threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t i = 0; i < threads; i++)
+        queues.push_back(std::make_unique<Queue>());
+    for (std::size_t i = 1; i < threads; i++)
+        workers.emplace_back([this, i]() { workerLoop(i); });
+}
+
+threadPool2d::~threadPool2d() {
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+std::size_t threadPool2d::getThreads() const { return workers.size() + 1; }
+
+std::size_t threadPool2d::queueIndex() const {
+    return currentThread.pool == this ? currentThread.index : 0;
+}
+
+// newest task of the own deque, else the oldest one of another
+bool threadPool2d::runOne(std::size_t self) {
+    Task task;
+    for (std::size_t i = 0; i < queues.size() && !task.fn; i++) {
+        Queue &queue = *queues[(self + i) % queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued--;
+    }
+    if (!task.fn)
+        return false;
+
+    task.fn();
+    task.group->pending--;
+    return true;
+}
+
+void threadPool2d::workerLoop(std::size_t index) {
+    currentThread = {this, index};
+    for (;;) {
+        if (runOne(index))
+            continue;
+
+        std::unique_lock lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || queued > 0; });
+        if (stopping)
+            return;
+    }
+}
+
+void threadPool2d::spawn(taskGroup2d &group, std::function<void()> fn) {
+    group.pending++;
+    Queue &queue = *queues[queueIndex()];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back({std::move(fn), &group});
+    }
+    queued++;
+
+    // a worker between its queued check and its wait gets the notify
+    { std::lock_guard lock(sleepMutex); }
+    wake.notify_one();
+}
+
+void threadPool2d::wait(taskGroup2d &group) {
+    std::size_t self = queueIndex();
+    while (!group.done())
+        if (!runOne(self))
+            std::this_thread::yield();
+}
+
+void threadPool2d::run(std::size_t chunks,
+                       const std::function<void(std::size_t)> &fn) {
+    if (workers.empty() || chunks <= 1) {
+        for (std::size_t chunk = 0; chunk < chunks; chunk++)
+            fn(chunk);
+        return;
+    }
+
+    taskGroup2d group;
+    for (std::size_t chunk = 0; chunk < chunks; chunk++)
+        spawn(group, [&fn, chunk]() { fn(chunk); });
+    wait(group);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing scheduler. Every worker has a task deque, it runs its newest
+// task first and idle workers steal the oldest task of another deque.
+// Threads outside the pool share one more deque. Waiting threads run tasks
+// meanwhile, so tasks may spawn and wait on tasks of their own.
+
+class taskGroup2d {
+    std::atomic<std::size_t> pending{0};
+
+    friend class threadPool2d;
+
+  public:
+    bool done() const;
+};
+
+class threadPool2d {
+    struct Task {
+        std::function<void()> fn;
+        taskGroup2d *group;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    // [0] for the threads outside the pool, [i] owned by worker i
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<std::size_t> queued{0};
+    bool stopping = false;
+
+    std::size_t queueIndex() const; // of the calling thread
+    bool runOne(std::size_t self);
+    void workerLoop(std::size_t index);
+
+  public:
+    // threads counts the calling one, 0 takes every hardware thread
+    explicit threadPool2d(std::size_t threads = 0);
+    threadPool2d(const threadPool2d &) = delete;
+    threadPool2d &operator=(const threadPool2d &) = delete;
+    ~threadPool2d();
+
+    std::size_t getThreads() const;
+
+    void spawn(taskGroup2d &group, std::function<void()> fn);
+    // returns once every task of group is done, tasks of any group run on
+    // the calling thread meanwhile
+    void wait(taskGroup2d &group);
+
+    // fn(chunk) for every chunk in [0, chunks), in no particular order
+    void run(std::size_t chunks, const std::function<void(std::size_t)> &fn);
+
+    // fn(begin, end) over [0, count) in ranges of grain items
+    template <typename F>
+    void parallelFor(std::size_t count, std::size_t grain, F &&fn) {
+        run((count + grain - 1) / grain, [&](std::size_t chunk) {
+            std::size_t begin = chunk * grain;
+            fn(begin, std::min(begin + grain, count));
+        });
+    }
+};
@@ -0,0 +1,134 @@
+#include "twolevel2d.h"
+#include <algorithm>
+
+namespace {
+
+bool lessMinX(const bBox &bbox1, const bBox &bbox2) {
+    return bbox1.getMinX() < bbox2.getMinX();
+}
+
+bool overlapY(const bBox &bbox1, const bBox &bbox2) {
+    return bbox1.getMinY() <= bbox2.getMaxY() &&
+           bbox2.getMinY() <= bbox1.getMaxY();
+}
+
+} // namespace
+
+void TwoLevel2d::update(const std::list<object2d *> &objects) {
+    entries.clear();
+    primitives.clear();
+    for (auto object : objects) {
+        Entry entry{bBox(), object, std::uint32_t(primitives.size()), 0};
+        const auto &model = object->getCollisionModel_precalc();
+        const auto &bboxes = object->getCollisionModel_bBoxes();
+        for (std::size_t i = 0; i < model.size(); i++)
+            primitives.push_back({bboxes[i], object, model[i]});
+        entry.end = primitives.size();
+        if (entry.begin == entry.end)
+            continue;
+        entry.bbox = object->getBBox();
+
+        std::sort(begin(primitives) + entry.begin,
+                  begin(primitives) + entry.end,
+                  [](const Item &item1, const Item &item2) {
+                      return lessMinX(item1.bbox, item2.bbox);
+                  });
+        entries.push_back(entry);
+    }
+
+    std::sort(begin(entries), end(entries),
+              [](const Entry &entry1, const Entry &entry2) {
+                  return lessMinX(entry1.bbox, entry2.bbox);
+              });
+}
+
+// primitives of entry touching region, still sorted by min x
+void TwoLevel2d::gatherRegion(const Entry &entry, const bBox &region,
+                              std::vector<std::uint32_t> &result) const {
+    result.clear();
+    for (std::uint32_t i = entry.begin; i < entry.end; i++) {
+        const bBox &bbox = primitives[i].bbox;
+        if (bbox.getMinX() > region.getMaxX())
+            break;
+        if (bbox.intersect(region))
+            result.push_back(i);
+    }
+}
+
+// sweep of two sorted lists, every pair overlapping along x is met once
+void TwoLevel2d::primitivePairs(const Entry &entry1, const Entry &entry2,
+                                std::vector<std::pair<Item, Item>> &result) {
+    bBox region(std::max(entry1.bbox.getMinX(), entry2.bbox.getMinX()),
+                std::max(entry1.bbox.getMinY(), entry2.bbox.getMinY()),
+                std::min(entry1.bbox.getMaxX(), entry2.bbox.getMaxX()),
+                std::min(entry1.bbox.getMaxY(), entry2.bbox.getMaxY()));
+    gatherRegion(entry1, region, region1);
+    gatherRegion(entry2, region, region2);
+
+    bool ordered = entry1.object < entry2.object;
+    auto pushPair = [&](const Item &item1, const Item &item2) {
+        if (ordered)
+            result.push_back({item1, item2});
+        else
+            result.push_back({item2, item1});
+    };
+
+    std::size_t i = 0, j = 0;
+    while (i < region1.size() && j < region2.size()) {
+        const Item &item1 = primitives[region1[i]];
+        const Item &item2 = primitives[region2[j]];
+        if (!lessMinX(item2.bbox, item1.bbox)) {
+            for (std::size_t k = j; k < region2.size(); k++) {
+                const Item &other = primitives[region2[k]];
+                if (other.bbox.getMinX() > item1.bbox.getMaxX())
+                    break;
+                if (overlapY(item1.bbox, other.bbox))
+                    pushPair(item1, other);
+            }
+            i++;
+        } else {
+            for (std::size_t k = i; k < region1.size(); k++) {
+                const Item &other = primitives[region1[k]];
+                if (other.bbox.getMinX() > item2.bbox.getMaxX())
+                    break;
+                if (overlapY(item2.bbox, other.bbox))
+                    pushPair(other, item2);
+            }
+            j++;
+        }
+    }
+}
+
+void TwoLevel2d::findPairs(std::vector<std::pair<Item, Item>> &result) {
+    for (std::size_t i = 0; i < entries.size(); i++)
+        for (std::size_t j = i + 1; j < entries.size(); j++) {
+            if (entries[j].bbox.getMinX() > entries[i].bbox.getMaxX())
+                break;
+            if (overlapY(entries[i].bbox, entries[j].bbox))
+                primitivePairs(entries[i], entries[j], result);
+        }
+}
+
+void TwoLevel2d::intersect(const bBox &bbox, std::vector<Item> &result) {
+    for (const auto &entry : entries) {
+        if (entry.bbox.getMinX() > bbox.getMaxX())
+            break;
+        if (!entry.bbox.intersect(bbox))
+            continue;
+
+        gatherRegion(entry, bbox, region1);
+        for (auto i : region1)
+            result.push_back(primitives[i]);
+    }
+}
+
+void TwoLevel2d::precalcDebug_VBO(std::vector<float> &vertices) {
+    for (const auto &entry : entries)
+        pushBBoxVertices(vertices, entry.bbox);
+}
+
+std::size_t TwoLevel2d::memoryUsage() const {
+    return entries.capacity() * sizeof(Entry) +
+           primitives.capacity() * sizeof(Item) +
+           (region1.capacity() + region2.capacity()) * sizeof(std::uint32_t);
+}
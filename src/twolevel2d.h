@@ -0,0 +1,36 @@
+#pragma once
+
+#include "broadphase2d.h"
+#include <cstdint>
+#include <vector>
+
+// Object boxes first, primitives second. Overlapping object pairs come
+// from a sort and sweep of the object boxes along x, then only the
+// primitives of both objects inside the intersection of their boxes are
+// swept against each other. A brick of 400 circles costs one item on the
+// first level instead of 400.
+class TwoLevel2d : public broadphase2d {
+    struct Entry {
+        bBox bbox; // of the collision model
+        object2d *object;
+        std::uint32_t begin, end; // in primitives, sorted by min x
+    };
+
+    std::vector<Entry> entries; // sorted by min x
+    std::vector<Item> primitives;
+    std::vector<std::uint32_t> region1, region2;
+
+    void gatherRegion(const Entry &entry, const bBox &region,
+                      std::vector<std::uint32_t> &result) const;
+    void primitivePairs(const Entry &entry1, const Entry &entry2,
+                        std::vector<std::pair<Item, Item>> &result);
+
+  public:
+    TwoLevel2d() = default;
+
+    void update(const std::list<object2d *> &objects) override;
+    void findPairs(std::vector<std::pair<Item, Item>> &result) override;
+    void intersect(const bBox &bbox, std::vector<Item> &result) override;
+    void precalcDebug_VBO(std::vector<float> &vertices) override;
+    std::size_t memoryUsage() const override;
+};
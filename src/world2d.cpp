@@ -1,14 +1,27 @@
 #include "world2d.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <utility>
 
+world2d::world2d() { broadphase->setThreadPool(pool.get()); }
 world2d::~world2d() {
-    for (size_t i = 0; i < debug_VBO_number; i++) {
-        delete debug_VBO_array[i];
-        debug_VBO_array[i] = nullptr;
-    }
+    stop();
+    delete broadphase;
 }
 
-void world2d::addObject(object2d *object) { objects.push_back(object); }
-void world2d::deleteObject(object2d *object) { objects.remove(object); }
+void world2d::addObject(object2d *object) {
+    object->keepTransform();
+    objects.push_back(object);
+}
+void world2d::deleteObject(object2d *object) {
+    objects.remove(object);
+    connections.remove_if([object](connection2d *connection) {
+        return connection->getObject1() == object ||
+               connection->getObject2() == object;
+    });
+}
 void world2d::addConnection(connection2d *connection) {
     connections.push_back(connection);
 }
@@ -16,173 +29,479 @@ void world2d::deleteConnection(connection2d *connection) {
     connections.remove(connection);
 }
 
+void world2d::postAddObject(object2d *object) {
+    commands.push({commandQueue2d::Type::AddObject, object, nullptr, nullptr});
+}
+void world2d::postDeleteObject(object2d *object,
+                               std::function<void()> deleted) {
+    commands.push({commandQueue2d::Type::DeleteObject, object, nullptr,
+                   std::move(deleted)});
+}
+void world2d::postAddConnection(connection2d *connection) {
+    commands.push(
+        {commandQueue2d::Type::AddConnection, nullptr, connection, nullptr});
+}
+void world2d::postDeleteConnection(connection2d *connection,
+                                   std::function<void()> deleted) {
+    commands.push({commandQueue2d::Type::DeleteConnection, nullptr,
+                   connection, std::move(deleted)});
+}
+
+void world2d::post(std::function<void()> fn) {
+    commands.push({commandQueue2d::Type::Run, nullptr, nullptr, std::move(fn)});
+}
+
+void world2d::applyCommands() {
+    commands.drain([this](const commandQueue2d::Command &command) {
+        switch (command.type) {
+        case commandQueue2d::Type::AddObject:
+            addObject(command.object);
+            break;
+        case commandQueue2d::Type::DeleteObject:
+            deleteObject(command.object);
+            break;
+        case commandQueue2d::Type::AddConnection:
+            addConnection(command.connection);
+            break;
+        case commandQueue2d::Type::DeleteConnection:
+            deleteConnection(command.connection);
+            break;
+        case commandQueue2d::Type::Run:
+            break;
+        }
+        if (command.applied)
+            command.applied();
+    });
+}
+
 std::list<object2d *> &world2d::getObjects() { return objects; }
 
 void world2d::setCamera(const camera2d &newCamera) { camera = newCamera; }
 camera2d world2d::getCamera() { return camera; }
 
-void world2d::precalc(bool isDebug) {
-    for (auto debug_VBO : debug_VBO_array) {
-        delete debug_VBO;
-        debug_VBO = nullptr;
-    }
+void world2d::setBroadphase(BroadphaseType type) {
+    std::lock_guard lock(stepMutex);
+    if (type == broadphaseType)
+        return;
 
-    std::vector<float> vertices[debug_VBO_number];
+    delete broadphase;
+    broadphaseType = type;
+    broadphase = broadphase2d::create(type);
+    broadphase->setThreadPool(pool.get());
+}
+BroadphaseType world2d::getBroadphaseType() const { return broadphaseType; }
+broadphase2d *world2d::getBroadphase() { return broadphase; }
 
-    bool collisionModelBBox_init = false;
-    for (auto object : objects) {
-        object->precalcCollisionModel();
-        if (isDebug)
-            object->precalcDebug_VBO(vertices[1]);
-        object->precalcDisplayModel();
-
-        // bBox
-        if (collisionModelBBox_init)
-            collisionModel_bBox += object->getBBox();
-        else {
-            collisionModel_bBox = object->getBBox();
-            collisionModelBBox_init = true;
-        }
-    }
+void world2d::setThreads(std::size_t threads) {
+    std::lock_guard lock(stepMutex);
+    pool = std::make_unique<threadPool2d>(threads);
+    broadphase->setThreadPool(pool.get());
+}
+std::size_t world2d::getThreads() const { return pool->getThreads(); }
+
+void world2d::setSleeping(bool newSleeping) {
+    sleeping = newSleeping;
+    if (!sleeping)
+        for (auto object : objects)
+            object->wake();
+}
+bool world2d::getSleeping() const { return sleeping; }
+void world2d::setSleepThresholds(real speed, real angleSpeed, real time,
+                                 real depth) {
+    sleepSpeed = speed;
+    sleepAngleSpeed = angleSpeed;
+    sleepTime = time;
+    sleepDepth = depth;
+}
+
+void world2d::precalcObjects() {
+    objectsArray.assign(begin(objects), end(objects));
+    pool->parallelFor(objectsArray.size(), 64,
+                      [this](std::size_t begin, std::size_t end) {
+                          for (std::size_t i = begin; i < end; i++)
+                              if (!objectsArray[i]->getIsSleeping())
+                                  objectsArray[i]->precalcCollisionModel();
+                      });
+}
+
+void world2d::precalcDebug_objects() {
+    for (auto object : objects)
+        object->precalcDebug_VBO(debug_vertices_array[1]);
     for (auto connection : connections)
-        connection->precalcDebug_VBO(vertices[1]);
+        connection->precalcDebug_VBO(debug_vertices_array[1]);
+}
+
+void world2d::precalcDebug_broadphase() {
+    broadphase->precalcDebug_VBO(debug_vertices_array[0]);
+}
 
-    delete kdtree;
-    kdtree = new KDTree2d(collisionModel_bBox);
+void world2d::precalcDebug_interpolated() {
+    debug_vertices_array[1].clear();
+    real alpha = getInterpolation();
     for (auto object : objects)
-        object->precalcCollisionModel_KDTree(kdtree);
-    kdtree->precalcDebug_VBO(vertices[0]);
-
-    for (std::size_t i = 0; i < debug_VBO_number; i++) {
-        debug_VBO_array[i] = new QOpenGLBuffer();
-        debug_VBO_array[i]->create();
-        debug_VBO_array[i]->bind();
-        debug_VBO_array[i]->allocate(vertices[i].size() * sizeof(GLfloat));
-        debug_VBO_array[i]->write(0, vertices[i].data(),
-                                  vertices[i].size() * sizeof(GLfloat));
-        debug_VBO_array[i]->release();
+        object->precalcDebug_VBO(debug_vertices_array[1], alpha);
+    for (auto connection : connections)
+        connection->precalcDebug_VBO(debug_vertices_array[1], alpha);
+}
+
+void world2d::precalc(bool isDebug) {
+    // keep capacity, the buffers are refilled every frame
+    for (auto &v : debug_vertices_array)
+        v.clear();
+
+    precalcObjects();
+    if (isDebug)
+        precalcDebug_objects();
+
+    broadphase->update(objects);
+    if (isDebug)
+        precalcDebug_broadphase();
+}
+
+std::uint32_t world2d::objectIndex(const object2d *object) const {
+    return std::lower_bound(begin(objectIndices), end(objectIndices),
+                            std::make_pair(object, std::uint32_t(0)))
+        ->second;
+}
+
+// stable LSD radix sort by key, 8 bits per pass. The digit counts of every
+// pass come from one read, passes where every key has the same digit are
+// skipped.
+void world2d::radixSort(std::vector<PairKey> &keys,
+                        std::vector<PairKey> &temp) {
+    constexpr std::size_t bits = 8;
+    constexpr std::size_t buckets = 1 << bits;
+    constexpr std::size_t passes = 64 / bits;
+    std::array<std::array<std::uint32_t, buckets>, passes> offsets{};
+    if (keys.empty())
+        return;
+
+    for (const auto &key : keys)
+        for (std::size_t pass = 0; pass < passes; pass++)
+            offsets[pass][key.key >> pass * bits & (buckets - 1)]++;
+
+    temp.resize(keys.size());
+    for (std::size_t pass = 0; pass < passes; pass++) {
+        std::size_t shift = pass * bits;
+        auto &counts = offsets[pass];
+        if (counts[keys.front().key >> shift & (buckets - 1)] == keys.size())
+            continue;
+
+        std::uint32_t offset = 0;
+        for (auto &count : counts)
+            offset += std::exchange(count, offset);
+        for (const auto &key : keys)
+            temp[counts[key.key >> shift & (buckets - 1)]++] = key;
+        keys.swap(temp);
     }
 }
 
-void world2d::collisionDetection() {
-    std::vector<std::pair<Item, Item>> result;
-    kdtree->parseTree(result);
-    std::sort(
-        begin(result), end(result),
-        [](const std::pair<Item, Item> &i, const std::pair<Item, Item> &j) {
-            return i.first.object < j.first.object ||
-
-                   i.first.object == j.first.object &&
-                       i.second.object < j.second.object ||
-
-                   i.first.object == j.first.object &&
-                       i.second.object == j.second.object &&
-                       i.first.primitive < j.first.primitive ||
-
-                   i.first.object == j.first.object &&
-                       i.second.object == j.second.object &&
-                       i.first.primitive == j.first.primitive &&
-                       i.second.primitive < j.second.primitive;
-        });
-    auto uniqueEnd = std::unique(
-        begin(result), end(result),
-        [](const std::pair<Item, Item> &i, const std::pair<Item, Item> &j) {
-            return i.first.object == j.first.object &&
-                   i.first.primitive == j.first.primitive &&
-                   i.second.object == j.second.object &&
-                   i.second.primitive == j.second.primitive;
-        });
-    result.erase(uniqueEnd, end(result));
+// one dispatch per pair in pairs order, split between threads
+void world2d::narrowphase() {
+    constexpr std::size_t grain = 1024;
+    pairHits.resize(pairs.size());
+    pairPoints.resize(pairs.size());
+    pool->parallelFor(pairs.size(), grain, [this](std::size_t begin,
+                                                  std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+            pairHits[i] = collisionPrimitives(*pairs[i].first.primitive,
+                                              *pairs[i].second.primitive,
+                                              pairPoints[i]);
+    });
+}
 
-    collisionPoints.clear();
-    for (auto Items : result) {
-        collisionPrimitivesPoint point;
-        if (collisionPrimitives(*Items.first.primitive, *Items.second.primitive,
-                                point)) {
-            if (collisionPoints.empty() ||
-                collisionPoints.back().getObj1() != Items.first.object ||
-                collisionPoints.back().getObj2() != Items.second.object)
-
-                collisionPoints.push_back(collisionObjectsPoint(
+// contacts of pairKeys[begin, end), one per object pair
+void world2d::mergeContacts(std::size_t begin, std::size_t end,
+                            std::vector<collisionObjectsPoint> &result) const {
+    for (std::size_t i = begin; i < end; i++) {
+        std::uint32_t index = pairKeys[i].index;
+        const auto &Items = pairs[index];
+        if (pairHits[index]) {
+            const auto &point = pairPoints[index];
+            if (result.empty() ||
+                result.back().getObj1() != Items.first.object ||
+                result.back().getObj2() != Items.second.object)
+
+                result.push_back(collisionObjectsPoint(
                     Items.first.object, Items.second.object, point.getPos(),
                     point.getNormal1(), point.getNormal2(), point.getDepth()));
             else {
-                collisionPoints.back().setPos(
-                    (collisionPoints.back().getPos() + point.getPos()) / 2);
-                collisionPoints.back().setNormal1(
-                    (collisionPoints.back().getNormal1() + point.getNormal1())
-                        .normed());
-                collisionPoints.back().setNormal2(
-                    (collisionPoints.back().getNormal2() + point.getNormal2())
-                        .normed());
-                collisionPoints.back().setDepth(
-                    (collisionPoints.back().getDepth() + point.getDepth()) / 2);
+                result.back().setPos((result.back().getPos() + point.getPos()) /
+                                     2);
+                result.back().setNormal1(
+                    (result.back().getNormal1() + point.getNormal1()).normed());
+                result.back().setNormal2(
+                    (result.back().getNormal2() + point.getNormal2()).normed());
+                result.back().setDepth(
+                    (result.back().getDepth() + point.getDepth()) / 2);
             }
         }
     }
+}
+
+void world2d::collisionDetection() {
+    // broadphases give no duplicates, the pairs only have to be grouped by
+    // objects for the contacts merge below
+    pairs.clear();
+    broadphase->findPairs(pairs);
+    // nothing moves in pairs of sleeping and fixed objects
+    std::erase_if(pairs, [](const std::pair<Item, Item> &pair) {
+        auto still = [](const object2d *object) {
+            return object->getIsSleeping() || object->getIsFixed();
+        };
+        return still(pair.first.object) && still(pair.second.object);
+    });
+
+    objectIndices.clear();
+    for (auto object : objects)
+        objectIndices.push_back({object, objectIndices.size()});
+    std::sort(begin(objectIndices), end(objectIndices));
+
+    constexpr std::size_t grain = 4096;
+    pairKeys.resize(pairs.size());
+    pool->parallelFor(pairs.size(), grain, [this](std::size_t begin,
+                                                  std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            std::uint64_t index1 = objectIndex(pairs[i].first.object);
+            std::uint64_t index2 = objectIndex(pairs[i].second.object);
+            pairKeys[i] = {index1 << 32 | index2, std::uint32_t(i)};
+        }
+    });
+    radixSort(pairKeys, pairKeysTemp);
+    narrowphase();
+
+    // ranges end on object pair changes, so every object pair is merged
+    // by one thread in pair key order whatever the thread number
+    std::size_t chunks =
+        std::min(pool->getThreads(), pairKeys.size() / grain + 1);
+    mergeBounds.assign(1, 0);
+    for (std::size_t chunk = 1; chunk < chunks; chunk++) {
+        std::size_t bound = std::max<std::size_t>(
+            pairKeys.size() * chunk / chunks, mergeBounds.back());
+        while (bound > 0 && bound < pairKeys.size() &&
+               pairKeys[bound].key == pairKeys[bound - 1].key)
+            bound++;
+        mergeBounds.push_back(bound);
+    }
+    mergeBounds.push_back(pairKeys.size());
 
-    // qDebug() << result.size() << " " << collisionPoints.size();
+    collisionPoints.clear();
+    if (chunks == 1)
+        mergeContacts(0, pairKeys.size(), collisionPoints);
+    else {
+        mergePoints.resize(chunks);
+        pool->run(chunks, [this](std::size_t chunk) {
+            mergePoints[chunk].clear();
+            mergeContacts(mergeBounds[chunk], mergeBounds[chunk + 1],
+                          mergePoints[chunk]);
+        });
+        for (const auto &points : mergePoints)
+            collisionPoints.insert(end(collisionPoints), begin(points),
+                                   end(points));
+    }
+
+    // qDebug() << pairs.size() << " " << collisionPoints.size();
 }
 
-void world2d::collisionResolve() {
-    for (auto &point : collisionPoints) {
-        // pull out objects from each other
-        vec2d dist = point.getObj2()->getPos() - point.getObj1()->getPos();
-        dist.norm();
-        vec2d pullout_v1, pullout_v2;
-        if (dist.dotProduct(point.getNormal1()) > 0.1)
-            pullout_v1 = point.getNormal1();
-        else
-            pullout_v1 = dist;
-
-        if (dist.dotProduct(point.getNormal2()) < -0.1)
-            pullout_v2 = point.getNormal2();
-        else
-            pullout_v2 = -dist;
-
-        if (!point.getObj1()->getIsFixed() && !point.getObj2()->getIsFixed()) {
-            double cosA1 = point.getObj1()->getSpeed().dotProduct(pullout_v1);
-            double cosA2 = point.getObj2()->getSpeed().dotProduct(pullout_v2);
-
-            point.getObj1()->setPos(point.getObj1()->getPos() +
-                                    pullout_v2 * point.getDepth() / 2);
-            if (cosA1 > 0) {
-                point.getObj1()->setSpeed(point.getObj1()->getSpeed() -
-                                          pullout_v1 * cosA1);
-                point.getObj2()->setSpeed(point.getObj2()->getSpeed() +
-                                          pullout_v1 * cosA1);
-            }
+namespace {
 
-            point.getObj2()->setPos(point.getObj2()->getPos() +
-                                    pullout_v1 * point.getDepth() / 2);
-            if (cosA2 > 0) {
-                point.getObj2()->setSpeed(point.getObj2()->getSpeed() -
-                                          pullout_v2 * cosA2);
-                point.getObj1()->setSpeed(point.getObj1()->getSpeed() +
-                                          pullout_v2 * cosA2);
-            }
-        } else if (!point.getObj1()->getIsFixed()) {
-            point.getObj1()->setPos(point.getObj1()->getPos() +
-                                    pullout_v2 * point.getDepth());
-            double cosA1 = point.getObj1()->getSpeed().dotProduct(pullout_v1);
-            if (cosA1 > 0)
-                point.getObj1()->setSpeed(point.getObj1()->getSpeed() -
-                                          pullout_v1 * cosA1);
-        } else if (!point.getObj2()->getIsFixed()) {
-            point.getObj2()->setPos(point.getObj2()->getPos() +
-                                    pullout_v1 * point.getDepth());
-            double cosA2 = point.getObj2()->getSpeed().dotProduct(pullout_v2);
-            if (cosA2 > 0)
-                point.getObj2()->setSpeed(point.getObj2()->getSpeed() -
-                                          pullout_v2 * cosA2);
+// speeds lose viscosity * sec of themselves in a step
+constexpr double viscosity = 0.005;
+
+// moves only the objects that are not fixed. Sleeping islands keep their
+// contacts, their objects stay where the broadphase has them.
+void resolveContact(collisionObjectsPoint &point) {
+    if (point.getObj1()->getIsSleeping() || point.getObj2()->getIsSleeping())
+        return;
+
+    // pull out objects from each other
+    vec2d dist = point.getObj2()->getPos() - point.getObj1()->getPos();
+    dist.norm();
+    vec2d pullout_v1, pullout_v2;
+    if (dist.dotProduct(point.getNormal1()) > 0.1)
+        pullout_v1 = point.getNormal1();
+    else
+        pullout_v1 = dist;
+
+    if (dist.dotProduct(point.getNormal2()) < -0.1)
+        pullout_v2 = point.getNormal2();
+    else
+        pullout_v2 = -dist;
+
+    if (!point.getObj1()->getIsFixed() && !point.getObj2()->getIsFixed()) {
+        real cosA1 = point.getObj1()->getSpeed().dotProduct(pullout_v1);
+        real cosA2 = point.getObj2()->getSpeed().dotProduct(pullout_v2);
+
+        point.getObj1()->setPos(point.getObj1()->getPos() +
+                                pullout_v2 * point.getDepth() / 2);
+        if (cosA1 > 0) {
+            point.getObj1()->setSpeed(point.getObj1()->getSpeed() -
+                                      pullout_v1 * cosA1);
+            point.getObj2()->setSpeed(point.getObj2()->getSpeed() +
+                                      pullout_v1 * cosA1);
+        }
+
+        point.getObj2()->setPos(point.getObj2()->getPos() +
+                                pullout_v1 * point.getDepth() / 2);
+        if (cosA2 > 0) {
+            point.getObj2()->setSpeed(point.getObj2()->getSpeed() -
+                                      pullout_v2 * cosA2);
+            point.getObj1()->setSpeed(point.getObj1()->getSpeed() +
+                                      pullout_v2 * cosA2);
         }
+    } else if (!point.getObj1()->getIsFixed()) {
+        point.getObj1()->setPos(point.getObj1()->getPos() +
+                                pullout_v2 * point.getDepth());
+        real cosA1 = point.getObj1()->getSpeed().dotProduct(pullout_v1);
+        if (cosA1 > 0)
+            point.getObj1()->setSpeed(point.getObj1()->getSpeed() -
+                                      pullout_v1 * cosA1);
+    } else if (!point.getObj2()->getIsFixed()) {
+        point.getObj2()->setPos(point.getObj2()->getPos() +
+                                pullout_v1 * point.getDepth());
+        real cosA2 = point.getObj2()->getSpeed().dotProduct(pullout_v2);
+        if (cosA2 > 0)
+            point.getObj2()->setSpeed(point.getObj2()->getSpeed() -
+                                      pullout_v2 * cosA2);
+    }
+}
+
+} // namespace
+
+std::uint32_t world2d::findIsland(std::uint32_t object) {
+    while (islandParent[object] != object)
+        object = islandParent[object] = islandParent[islandParent[object]];
+    return object;
+}
+
+// fixed objects never move in collisionResolve, they do not link islands
+void world2d::uniteIslands(const object2d *object1, const object2d *object2) {
+    if (!object1 || !object2 || object1->getIsFixed() || object2->getIsFixed())
+        return;
+    // a connection may outlive its objects in the world
+    auto known = [this](const object2d *object) {
+        return std::binary_search(
+            begin(objectIndices), end(objectIndices),
+            std::make_pair(object, std::uint32_t(0)),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+    };
+    if (!known(object1) || !known(object2))
+        return;
+    std::uint32_t island1 = findIsland(objectIndex(object1));
+    std::uint32_t island2 = findIsland(objectIndex(object2));
+    islandParent[std::max(island1, island2)] = std::min(island1, island2);
+}
+
+void world2d::buildIslands() {
+    islandParent.resize(objectIndices.size());
+    for (std::uint32_t i = 0; i < islandParent.size(); i++)
+        islandParent[i] = i;
+    for (const auto &point : collisionPoints)
+        uniteIslands(point.getObj1(), point.getObj2());
+    for (auto connection : connections)
+        uniteIslands(connection->getObject1(), connection->getObject2());
+}
+
+// counting sort of the contacts by island, stable
+void world2d::groupContacts() {
+    islandOffsets.assign(islandParent.size() + 1, 0);
+    islandContacts.resize(collisionPoints.size());
+    auto island = [this](const collisionObjectsPoint &point) {
+        const object2d *object = point.getObj1()->getIsFixed()
+                                     ? point.getObj2()
+                                     : point.getObj1();
+        return findIsland(objectIndex(object));
+    };
+    for (const auto &point : collisionPoints)
+        islandOffsets[island(point) + 1]++;
+    for (std::size_t i = 1; i < islandOffsets.size(); i++)
+        islandOffsets[i] += islandOffsets[i - 1];
+    for (std::uint32_t i = 0; i < collisionPoints.size(); i++)
+        islandContacts[islandOffsets[island(collisionPoints[i])]++] = i;
+    // back to the island begins
+    for (std::size_t i = islandOffsets.size() - 1; i > 0; i--)
+        islandOffsets[i] = islandOffsets[i - 1];
+    islandOffsets[0] = 0;
+}
+
+// islands touch different objects, so they are resolved concurrently. The
+// contacts of an island keep their order, the result is the serial one.
+void world2d::collisionResolve() {
+    // in the objectIndices order
+    objectsArray.assign(begin(objects), end(objects));
+    buildIslands();
+    if (sleeping) {
+        wakeIslands();
+        sleepIslands();
     }
+
+    constexpr std::size_t grain = 256;
+    if (pool->getThreads() == 1 || collisionPoints.size() < grain) {
+        for (auto &point : collisionPoints)
+            resolveContact(point);
+    } else {
+        groupContacts();
+        resolveIslands(grain);
+    }
+}
+
+void world2d::resolveIslands(std::size_t grain) {
+    // ranges of islandContacts ending on island ends
+    resolveBounds.assign(1, 0);
+    for (std::size_t island = 0; island < islandParent.size(); island++)
+        if (islandOffsets[island + 1] - resolveBounds.back() >= grain)
+            resolveBounds.push_back(islandOffsets[island + 1]);
+    if (resolveBounds.back() != islandContacts.size())
+        resolveBounds.push_back(islandContacts.size());
+
+    pool->run(resolveBounds.size() - 1, [this](std::size_t chunk) {
+        for (std::uint32_t i = resolveBounds[chunk];
+             i < resolveBounds[chunk + 1]; i++)
+            resolveContact(collisionPoints[islandContacts[i]]);
+    });
+}
+
+// one awake object wakes its whole island, a contact or a connection with
+// an awake object included
+void world2d::wakeIslands() {
+    islandFlags.assign(objectsArray.size(), 0);
+    for (std::uint32_t i = 0; i < objectsArray.size(); i++)
+        if (!objectsArray[i]->getIsFixed() && !objectsArray[i]->getIsSleeping())
+            islandFlags[findIsland(i)] = 1;
+    for (std::uint32_t i = 0; i < objectsArray.size(); i++)
+        if (objectsArray[i]->getIsSleeping() && islandFlags[findIsland(i)])
+            objectsArray[i]->wake();
+}
+
+// an island falls asleep once all of its objects rest, the contacts do not
+// move them any more
+void world2d::sleepIslands() {
+    auto rests = [this](const object2d *object) {
+        return object->getRestTime() >= sleepTime &&
+               object->getSpeed().length2() < sleepSpeed * sleepSpeed &&
+               std::abs(object->getAngleSpeed()) < sleepAngleSpeed;
+    };
+    islandFlags.assign(objectsArray.size(), 1);
+    for (std::uint32_t i = 0; i < objectsArray.size(); i++)
+        if (!objectsArray[i]->getIsFixed() && !rests(objectsArray[i]))
+            islandFlags[findIsland(i)] = 0;
+    for (const auto &point : collisionPoints)
+        if (point.getDepth() > sleepDepth) {
+            const object2d *object = point.getObj1()->getIsFixed()
+                                         ? point.getObj2()
+                                         : point.getObj1();
+            islandFlags[findIsland(objectIndex(object))] = 0;
+        }
+    for (std::uint32_t i = 0; i < objectsArray.size(); i++)
+        if (!objectsArray[i]->getIsFixed() &&
+            !objectsArray[i]->getIsSleeping() && islandFlags[findIsland(i)])
+            objectsArray[i]->setIsSleeping(true);
 }
 
 void world2d::intersect(const primitive2d &primitive,
                         std::vector<Item> &result) {
     std::vector<Item> temp_result;
-    kdtree->intersect(primitive.getBBox(), temp_result);
+    broadphase->intersect(primitive.getBBox(), temp_result);
 
     collisionPrimitivesPoint p;
     for (const auto &item : temp_result)
@@ -195,17 +514,42 @@ void world2d::intersect(const vec2d &point, std::vector<Item> &result) {
     // TODO without using circle2d class
 }
 
-void world2d::update(double sec) {
-    for (auto obj : objects) {
-        obj->setPos(obj->getPos() + obj->getSpeed() * sec);
-        obj->setAngle(obj->getAngle() + obj->getAngleSpeed() * sec);
-
-        // slow down objects
-        constexpr double viscosity = 0.005;
-        obj->setSpeed(obj->getSpeed() * (1 - viscosity * sec));
-        obj->setAngleSpeed(obj->getAngleSpeed() * (1 - viscosity * sec));
-    }
+void world2d::integrate(double sec) {
+    objectsArray.assign(begin(objects), end(objects));
+    pool->parallelFor(
+        objectsArray.size(), 1024,
+        [this, sec](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                object2d *obj = objectsArray[i];
+                obj->keepTransform();
+                if (obj->getIsSleeping())
+                    continue;
+                obj->setPos(obj->getPos() + obj->getSpeed() * sec);
+                obj->setAngle(obj->getAngle() + obj->getAngleSpeed() * sec);
+
+                // slow down objects
+                obj->setSpeed(obj->getSpeed() * (1 - viscosity * sec));
+                obj->setAngleSpeed(obj->getAngleSpeed() *
+                                   (1 - viscosity * sec));
+
+                if (sleeping &&
+                    obj->getSpeed().length2() < sleepSpeed * sleepSpeed &&
+                    std::abs(obj->getAngleSpeed()) < sleepAngleSpeed)
+                    obj->setRestTime(obj->getRestTime() + sec);
+                else
+                    obj->setRestTime(0);
+            }
+        });
+}
 
+// forces on both objects of a connection, in order. A sleeping object only
+// takes a force that would keep it above sleepSpeed against the viscosity,
+// which wakes it.
+void world2d::applyConnections(double sec) {
+    auto applies = [this, sec](const object2d *object, vec2d force) {
+        return !object->getIsSleeping() ||
+               force.length() > sleepSpeed * viscosity * sec;
+    };
     for (auto connection : connections) {
         vec2d worldPoint1 = connection->getWorldPoint1();
         vec2d worldPoint2 = connection->getWorldPoint2();
@@ -213,23 +557,194 @@ void world2d::update(double sec) {
         if (connection->getObject1()) {
             vec2d dist = connection->getObject1()->worldToObject(worldPoint2) -
                          connection->getPoint1();
-            connection->getObject1()->applyForceLocal(dist * 0.0002,
-                                                      connection->getPoint1());
+            if (applies(connection->getObject1(), dist * 0.0002))
+                connection->getObject1()->applyForceLocal(
+                    dist * 0.0002, connection->getPoint1());
         }
         if (connection->getObject2()) {
             vec2d dist = connection->getObject2()->worldToObject(worldPoint1) -
                          connection->getPoint2();
-            connection->getObject2()->applyForceLocal(dist * 0.0002,
-                                                      connection->getPoint2());
+            if (applies(connection->getObject2(), dist * 0.0002))
+                connection->getObject2()->applyForceLocal(
+                    dist * 0.0002, connection->getPoint2());
         }
     }
 }
 
-QOpenGLBuffer *world2d::getDebug_VBO(std::size_t index) {
-    return debug_VBO_array[index];
+void world2d::update(double sec) {
+    applyCommands();
+    integrate(sec);
+    applyConnections(sec);
+}
+
+void world2d::step(double sec, bool isDebug) {
+    for (auto &v : debug_vertices_array)
+        v.clear();
+
+    taskGraph2d graph;
+    auto updated = graph.add([this, sec]() { update(sec); });
+    auto precalced = graph.add([this]() { precalcObjects(); }, {updated});
+    auto broadphaseUpdated =
+        graph.add([this]() { broadphase->update(objects); }, {precalced});
+    auto detected =
+        graph.add([this]() { collisionDetection(); }, {broadphaseUpdated});
+    if (isDebug) {
+        // the objects only move again in collisionResolve
+        auto objectsDebugged =
+            graph.add([this]() { precalcDebug_objects(); }, {precalced});
+        graph.add([this]() { collisionResolve(); },
+                  {detected, objectsDebugged});
+        graph.add([this]() { precalcDebug_broadphase(); }, {detected});
+    } else
+        graph.add([this]() { collisionResolve(); }, {detected});
+    graph.run(*pool);
+}
+
+std::size_t world2d::advanceSteps(double elapsed, bool isDebug) {
+    accumulator += elapsed;
+    std::size_t steps =
+        std::min(std::size_t(accumulator / tick), maxSubsteps);
+    for (std::size_t i = 0; i < steps; i++)
+        step(tick, isDebug && i + 1 == steps);
+    stepCount += steps;
+    accumulator -= steps * tick;
+    // never catch up, every later frame would need more steps
+    if (accumulator >= tick)
+        accumulator = std::fmod(accumulator, tick);
+    return steps;
+}
+
+std::size_t world2d::advance(double elapsed, bool isDebug) {
+    std::size_t steps = advanceSteps(elapsed, isDebug);
+    if (isDebug)
+        precalcDebug_interpolated();
+    return steps;
+}
+
+void world2d::setTick(double newTick) {
+    std::lock_guard lock(stepMutex);
+    if (newTick > 0) // NaN too
+        tick = newTick;
+}
+double world2d::getTick() const { return tick; }
+void world2d::setMaxSubsteps(std::size_t newMaxSubsteps) {
+    std::lock_guard lock(stepMutex);
+    maxSubsteps = std::max<std::size_t>(newMaxSubsteps, 1);
+}
+std::size_t world2d::getMaxSubsteps() const { return maxSubsteps; }
+double world2d::getInterpolation() const { return accumulator / tick; }
+
+void world2d::publish(bool isDebug, snapshot2d::clock::time_point now) {
+    snapshot2d &snapshot = snapshots.getWriteBuffer();
+    snapshot.steps = stepCount;
+    snapshot.stepTime =
+        now - std::chrono::duration_cast<snapshot2d::clock::duration>(
+                  std::chrono::duration<double, std::milli>(accumulator));
+    snapshot.tick = tick;
+    snapshot.transforms.clear();
+    for (auto object : objects)
+        snapshot.transforms.push_back(
+            {object, object->getPos(), object->getPrevPos(),
+             object->getAngle(), object->getPrevAngle()});
+
+    for (auto &vertices : snapshot.debug_vertices_array)
+        vertices.clear();
+    snapshot.debugRanges.clear();
+    if (isDebug)
+        publishDebug(snapshot);
+    snapshots.publish();
+}
+
+// the objects debug vertices at their models and the connection ends in
+// object coords, the render side moves them to the interpolated transforms
+void world2d::publishDebug(snapshot2d &snapshot) {
+    snapshot.debug_vertices_array[0] = debug_vertices_array[0];
+    auto &vertices = snapshot.debug_vertices_array[1];
+    std::uint32_t transform = 0;
+    for (auto object : objects) {
+        std::uint32_t begin = vertices.size();
+        object->precalcDebug_VBO(vertices);
+        snapshot.debugRanges.push_back(
+            {begin, std::uint32_t(vertices.size()), transform++,
+             object->getCollisionModel_matrix().inverted()});
+    }
+
+    publishIndices.clear();
+    for (std::uint32_t i = 0; i < snapshot.transforms.size(); i++)
+        publishIndices.push_back({snapshot.transforms[i].object, i});
+    std::sort(begin(publishIndices), end(publishIndices));
+    constexpr std::uint32_t none = -1;
+    auto transformOf = [this](const object2d *object) {
+        auto it = std::lower_bound(
+            begin(publishIndices), end(publishIndices),
+            std::pair<const object2d *, std::uint32_t>(object, 0));
+        return object && it != end(publishIndices) && it->first == object
+                   ? it->second
+                   : none;
+    };
+    auto pushEnd = [&](std::uint32_t transform, const vec2d &point) {
+        if (transform != none) {
+            std::uint32_t begin = vertices.size();
+            snapshot.debugRanges.push_back(
+                {begin, begin + 2, transform, mat23::makeIdentity()});
+        }
+        vertices.push_back(point.x());
+        vertices.push_back(point.y());
+    };
+    for (auto connection : connections) {
+        object2d *object1 = connection->getObject1();
+        object2d *object2 = connection->getObject2();
+        std::uint32_t transform1 = transformOf(object1);
+        std::uint32_t transform2 = transformOf(object2);
+        // an end on an object out of the world has no transform
+        if ((object1 && transform1 == none) || (object2 && transform2 == none))
+            continue;
+        pushEnd(transform1, connection->getPoint1());
+        pushEnd(transform2, connection->getPoint2());
+    }
 }
-QVector4D world2d::getDebug_color(std::size_t index) {
-    return debug_colors_array[index];
+
+// sleeps until the next tick is due
+void world2d::stepLoop(bool isDebug) {
+    using clock = std::chrono::steady_clock;
+    auto last = clock::now();
+    while (stepping) {
+        double wait;
+        {
+            std::lock_guard lock(stepMutex);
+            auto now = clock::now();
+            advanceSteps(
+                std::chrono::duration<double, std::milli>(now - last).count(),
+                isDebug);
+            last = now;
+            publish(isDebug, now);
+            wait = tick - accumulator;
+        }
+        std::this_thread::sleep_for(
+            std::chrono::duration<double, std::milli>(wait));
+    }
+}
+
+void world2d::start(bool isDebug) {
+    if (stepping)
+        return;
+    stepping = true;
+    stepThread = std::thread([this, isDebug]() { stepLoop(isDebug); });
+}
+
+void world2d::stop() {
+    if (!stepping)
+        return;
+    stepping = false;
+    stepThread.join();
+}
+
+std::mutex &world2d::getStepMutex() { return stepMutex; }
+
+const snapshot2d &world2d::getSnapshot() { return snapshots.read(); }
+
+const std::vector<float> &world2d::getDebug_vertices(std::size_t index) const {
+    return debug_vertices_array[index];
 }
 
 void world2d::destroy() { objects.clear(); }
\ No newline at end of file
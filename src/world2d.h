@@ -1,49 +1,188 @@
 #pragma once
 
+#include "broadphase2d.h"
 #include "camera2d.h"
+#include "commandqueue2d.h"
 #include "connection2d.h"
-#include "kdtree2d.h"
-#include "mesh2d.h"
 #include "object2d.h"
-#include <QDebug>
-#include <QOpenGLBuffer>
-#include <QOpenGLTexture>
-#include <QVector4D>
+#include "snapshot2d.h"
+#include "taskgraph2d.h"
+#include "threadpool2d.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <list>
-
-constexpr std::size_t debug_VBO_number = 2;
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 class world2d {
     camera2d camera;
     std::list<object2d *> objects;
     std::list<connection2d *> connections;
 
-    QOpenGLBuffer *debug_VBO_array[debug_VBO_number]{nullptr, nullptr};
-    QVector4D debug_colors_array[debug_VBO_number]{QVector4D(0, 1, 0, 1),
-                                                   QVector4D(1, 1, 1, 1)};
+    // GL_LINES vertex pairs, uploaded by the render layer
+    std::vector<float> debug_vertices_array[debug_VBO_number];
 
-    bBox collisionModel_bBox;
-    KDTree2d *kdtree = nullptr;
+    BroadphaseType broadphaseType = BroadphaseType::KDTree;
+    broadphase2d *broadphase = broadphase2d::create(broadphaseType);
     std::vector<collisionObjectsPoint> collisionPoints;
+    std::unique_ptr<threadPool2d> pool = std::make_unique<threadPool2d>();
+    // objects as an array for the parallel loops, refreshed every use
+    std::vector<object2d *> objectsArray;
+
+    // collisionDetection buffers, kept between frames
+    struct PairKey {
+        std::uint64_t key;   // object indices of the pair
+        std::uint32_t index; // in pairs
+    };
+    std::vector<std::pair<const object2d *, std::uint32_t>> objectIndices;
+    std::vector<std::pair<Item, Item>> pairs;
+    std::vector<PairKey> pairKeys, pairKeysTemp;
+    // narrowphase results by pair index
+    std::vector<std::uint8_t> pairHits;
+    std::vector<collisionPrimitivesPoint> pairPoints;
+    // pairKeys ranges merged by one thread each, joined in order
+    std::vector<std::uint32_t> mergeBounds;
+    std::vector<std::vector<collisionObjectsPoint>> mergePoints;
+
+    // islands, objects linked by contacts or connections with fixed objects
+    // as boundaries, by object index of objectIndices. islandContacts holds
+    // the collisionPoints of every island in a row, each in its order.
+    std::vector<std::uint32_t> islandParent;
+    std::vector<std::uint32_t> islandOffsets;
+    std::vector<std::uint32_t> islandContacts;
+    std::vector<std::uint32_t> resolveBounds;
+    std::vector<std::uint8_t> islandFlags;
+
+    // objects slower than both speeds for sleepTime fall asleep by islands,
+    // once the contacts pushed them apart to sleepDepth
+    bool sleeping = true;
+    real sleepSpeed = 0.001;
+    real sleepAngleSpeed = 0.0001;
+    real sleepTime = 100;
+    real sleepDepth = 0.01;
+
+    // advance steps of tick, the world time short of one waits in
+    // accumulator
+    double tick = 10;
+    std::size_t maxSubsteps = 5;
+    double accumulator = 0;
+    std::uint64_t stepCount = 0;
+
+    // start runs advance on stepThread, publishing to snapshots
+    snapshotBuffer2d snapshots;
+    std::thread stepThread;
+    std::atomic<bool> stepping{false};
+    std::mutex stepMutex;
+
+    commandQueue2d commands;
+    // object transform indices of the snapshot, sorted for the connections
+    std::vector<std::pair<const object2d *, std::uint32_t>> publishIndices;
+
+    void applyCommands();
+    std::size_t advanceSteps(double elapsed, bool isDebug);
+    void publish(bool isDebug, snapshot2d::clock::time_point now);
+    void publishDebug(snapshot2d &snapshot);
+    void stepLoop(bool isDebug);
+
+    void integrate(double sec);
+    void applyConnections(double sec);
+    void precalcObjects();
+    void precalcDebug_objects();
+    void precalcDebug_broadphase();
+    void precalcDebug_interpolated();
+
+    std::uint32_t objectIndex(const object2d *object) const;
+    static void radixSort(std::vector<PairKey> &keys,
+                          std::vector<PairKey> &temp);
+    void narrowphase();
+    void mergeContacts(std::size_t begin, std::size_t end,
+                       std::vector<collisionObjectsPoint> &result) const;
+    std::uint32_t findIsland(std::uint32_t object);
+    void uniteIslands(const object2d *object1, const object2d *object2);
+    void buildIslands();
+    void groupContacts();
+    void resolveIslands(std::size_t grain);
+    void wakeIslands();
+    void sleepIslands();
 
   public:
-    world2d() = default;
+    world2d();
+    world2d(const world2d &) = delete;
+    world2d &operator=(const world2d &) = delete;
     ~world2d();
 
     void addObject(object2d *object);
+    // removes the connections on the object as well, neither is deleted
     void deleteObject(object2d *object);
     void addConnection(connection2d *connection);
     void deleteConnection(connection2d *connection);
+    // the same from any thread without waiting, applied in order at the
+    // start of the next update. The world does not touch a deleted object or
+    // connection after that: deleted runs then, on the stepping thread with
+    // getStepMutex held, and may free it. Without deleted it may be freed
+    // after stop.
+    void postAddObject(object2d *object);
+    void postDeleteObject(object2d *object,
+                          std::function<void()> deleted = nullptr);
+    void postAddConnection(connection2d *connection);
+    void postDeleteConnection(connection2d *connection,
+                              std::function<void()> deleted = nullptr);
+    // runs fn in order with the posts above, on the stepping thread with
+    // getStepMutex held while it is started
+    void post(std::function<void()> fn);
     std::list<object2d *> &getObjects();
     void setCamera(const camera2d &newCamera);
     camera2d getCamera();
+    // setBroadphase and setThreads replace what a running step uses, they
+    // take getStepMutex themselves and must not be called holding it
+    void setBroadphase(BroadphaseType type);
+    BroadphaseType getBroadphaseType() const;
+    broadphase2d *getBroadphase();
+    // counts the calling thread, 0 takes every hardware thread. Results do
+    // not depend on it.
+    void setThreads(std::size_t threads);
+    std::size_t getThreads() const;
+    // off wakes every object
+    void setSleeping(bool newSleeping);
+    bool getSleeping() const;
+    void setSleepThresholds(real speed, real angleSpeed, real time,
+                            real depth);
     void precalc(bool isDebug = false);
     void collisionDetection();
     void collisionResolve();
     void intersect(const primitive2d &primitive, std::vector<Item> &result);
     void intersect(const vec2d &point, std::vector<Item> &result);
     void update(double sec);
-    QOpenGLBuffer *getDebug_VBO(std::size_t index);
-    QVector4D getDebug_color(std::size_t index);
+    // update, precalc, collisionDetection and collisionResolve as a task
+    // graph on the pool, the debug vertices are made beside the detection
+    void step(double sec, bool isDebug = false);
+    // steps of tick over elapsed and the rest of the last call, at most
+    // maxSubsteps, a longer delay is dropped. The objects debug vertices
+    // are at getInterpolation. Returns the steps taken.
+    std::size_t advance(double elapsed, bool isDebug = false);
+    // take getStepMutex like setBroadphase. A tick that is not positive is
+    // ignored, substeps are at least 1.
+    void setTick(double newTick);
+    double getTick() const;
+    void setMaxSubsteps(std::size_t newMaxSubsteps);
+    std::size_t getMaxSubsteps() const;
+    // the time since the last step in ticks, [0, 1), render objects at
+    // getInterpolatedMatrix of it
+    double getInterpolation() const;
+
+    // advance on a thread of its own every tick of wall time, world time is
+    // in milliseconds then. A snapshot is published after every call, the
+    // render side interpolates it by the wall clock. Other threads post
+    // changes, anything else they do to the world or its objects needs
+    // getStepMutex until stop.
+    void start(bool isDebug = false);
+    void stop();
+    std::mutex &getStepMutex();
+    // the latest published snapshot without waiting, for one reader thread
+    const snapshot2d &getSnapshot();
+    const std::vector<float> &getDebug_vertices(std::size_t index) const;
     void destroy();
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "math2d.h"
+
+// The constexpr paths of math2d, checked by the compiler for both scalar
+// types. Every value is exact in float, so the checks compare bits.
+
+namespace {
+
+template <typename T>
+constexpr bool same(const basicVec2d<T> &v, T x, T y) {
+    return v.x() == x && v.y() == y;
+}
+
+template <typename T> constexpr bool checkVec2d() {
+    using vec = basicVec2d<T>;
+    vec a(3, 4), b(-1, 0.5);
+
+    vec c = a;
+    c += b;
+    c -= vec(1, 1);
+    c *= 2;
+    c /= 4;
+
+    return same(vec(), T(0), T(0)) && same(a + b, T(2), T(4.5)) &&
+           same(a - b, T(4), T(3.5)) && same(-a, T(-3), T(-4)) &&
+           same(a * T(2), T(6), T(8)) && same(a / T(2), T(1.5), T(2)) &&
+           a.length2() == 25 && a.dotProduct(b) == -1 && a * b == -1 &&
+           a.det(b) == T(5.5) && same(a.perped(), T(-4), T(3)) &&
+           same(a.translated(1, -1), T(4), T(3)) &&
+           same(a.rotated(1, 0), T(-4), T(3)) && same(c, T(0.5), T(1.75));
+}
+
+template <typename T> constexpr bool checkMat23() {
+    using vec = basicVec2d<T>;
+    using mat = basicMat23<T>;
+    vec p(3, 4);
+
+    // a quarter turn, then scale and translation
+    mat m = mat::makeRotate(1, 0).scaled(2).translated(1, -1);
+    mat chained = mat::makeRotate(1, 0) * mat::makeScale(2) *
+                  mat::makeTranslate(vec(1, -1));
+    mat self = m;
+    self *= m.inverted();
+
+    return same(p * mat(), T(3), T(4)) &&
+           same(p * mat::makeIdentity(), T(3), T(4)) &&
+           same(p * mat::makeRotate(1, 0), T(-4), T(3)) &&
+           same(p * mat::makeScale(2, 3), T(6), T(12)) &&
+           same(p * m, T(-7), T(5)) && same(p * chained, T(-7), T(5)) &&
+           m.det() == 4 && same(p * m * m.inverted(), T(3), T(4)) &&
+           same(p * self, T(3), T(4)) &&
+           same(p * mat(vec(1, 0), vec(0, 1)), T(3), T(4));
+}
+
+static_assert(checkVec2d<float>() && checkVec2d<double>());
+static_assert(checkMat23<float>() && checkMat23<double>());
+static_assert(toDegrees(toRadians(90)) == 90);
+
+} // namespace
+
+int main() { return 0; }